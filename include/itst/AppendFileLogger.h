@@ -0,0 +1,41 @@
+#pragma once
+
+#include "itst/Sink.h"
+
+namespace itst {
+
+/// Appends to a file that is opened with O_APPEND and issues each record with
+/// exactly one write or writev syscall. As the kernel appends such writes
+/// atomically (on local file systems; not on NFS), several processes can log
+/// into the same file without their records interleaving and without an
+/// inter-process lock. Only if the kernel writes less than requested, e.g.,
+/// because the disk is full, the rest of the record follows in further
+/// syscalls and may interleave with the records of other processes.
+///
+/// With a batch_size, whole records are collected into batches of up to
+/// batch_size bytes, which are again issued with one syscall each. Records
+/// never straddle two syscalls; a record larger than the batch size is written
+/// on its own. The batch is written on flush(), after a message that reaches
+/// the logger's flush-severity and periodically by the BackgroundFlusher.
+class ITST_API AppendFileSink : public Sink<AppendFileSink, NoLock> {
+  friend Sink;
+
+public:
+  explicit AppendFileSink(const char *file_name,
+                          size_t batch_size = 0) noexcept;
+  ~AppendFileSink();
+
+  AppendFileSink(const AppendFileSink &) = delete;
+  AppendFileSink &operator=(const AppendFileSink &) = delete;
+
+private:
+  void writeImpl(const iovec *slices, size_t num_slices) noexcept;
+  void flushImpl() noexcept;
+
+  struct Impl;
+  Impl *impl{};
+};
+
+/// Logs into an AppendFileSink. Multiple loggers may share the same sink.
+using AppendFileLogger = SinkLogger<AppendFileSink>;
+} // namespace itst
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "itst/Core.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+namespace itst {
+
+/// The buffering modes of a stdio stream, see setvbuf.
+enum class BufferMode {
+  Full,
+  Line,
+  Unbuffered,
+};
+
+/// Changes the buffering of a stream that may already be in use, see setvbuf.
+/// Pending output is flushed first. The buffer must stay valid until the
+/// stream is closed; if it is nullptr, stdio allocates a buffer of its default
+/// size.
+bool ITST_API setStreamBuffering(FILE *file_handle, BufferMode mode,
+                                 char *buffer, size_t buffer_size) noexcept;
+
+/// Flushes registered streams periodically on a background thread.
+///
+/// This allows to run loggers with large buffers for throughput while still
+/// bounding the amount of records lost, if the process gets killed.
+/// The files opened by FileLoggers and the ConsoleLogger's target are
+/// registered automatically.
+///
+/// Streams that are locked by a logger at the time of a flush are skipped
+/// until the next interval, such that the flusher never blocks the logging
+/// threads.
+///
+/// The flusher relies on the lock of the stream, so a stream must not be
+/// flushed while a logger writes into it without locking it. Hence, while the
+/// locking of a FileLogger or a ConsoleLogger is turned off (see
+/// setStreamLocking()), its stream is paused, i.e., skipped by the flusher.
+/// Loggers with the NoLock policy must not write into a registered stream
+/// while the flusher runs.
+class ITST_API BackgroundFlusher {
+public:
+  using FlushFn = void (*)(void *context) noexcept;
+
+  /// Starts the background thread, or changes the interval, if it is already
+  /// running.
+  static void start(std::chrono::milliseconds interval) noexcept;
+
+  /// Stops the background thread after a final flush.
+  static void stop() noexcept;
+
+  /// Flushes all registered streams once, on the calling thread.
+  static void flushAll() noexcept;
+
+  static void add(FILE *file_handle) noexcept;
+  static void remove(FILE *file_handle) noexcept;
+
+  /// Skips the registered stream until resume() is called as often as
+  /// pause(). Waits until a running flush of the stream has finished, such
+  /// that the caller may write into the stream without locking it afterwards.
+  static void pause(FILE *file_handle) noexcept;
+  static void resume(FILE *file_handle) noexcept;
+
+  /// Registers a custom flush callback for destinations that are not stdio
+  /// streams. The callbacks run without holding the flusher's lock, but each
+  /// one on at most one thread at a time; remove() waits until a running
+  /// callback has returned. Hence, a callback must not call remove() itself.
+  static void add(FlushFn flush, void *context) noexcept;
+  static void remove(FlushFn flush, void *context) noexcept;
+};
+} // namespace itst
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "itst/Core.h"
+#include "itst/LogSeverity.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace itst {
+
+enum class CallSiteState : uint8_t {
+  /// The site has not been executed yet
+  Unregistered,
+  /// The logger's severity decides, whether the site logs
+  Default,
+  /// The site logs regardless of the logger's severity
+  Enabled,
+  /// The site never logs
+  Disabled,
+};
+
+/// The static descriptor of one ITST_LOG or ITST_LOGF statement, similar to the
+/// descriptors of Linux' dynamic debug.
+///
+/// The descriptor is constant-initialized, so checking its state costs a
+/// single relaxed load. It registers itself in the CallSiteRegistry when it is
+/// executed for the first time. See CallSiteRegistry.h to list the sites and
+/// to change their states.
+struct CallSite {
+  const char *file{};
+  const char *function{};
+  /// The format string, or the logged expressions for ITST_LOG
+  const char *format{};
+  unsigned line{};
+  LogSeverity severity{};
+  mutable std::atomic<CallSiteState> state{CallSiteState::Unregistered};
+  /// Consecutive number, assigned when the site registers
+  mutable uint32_t id{};
+  /// The next site in the registry
+  mutable const CallSite *next{};
+
+  constexpr CallSite(const char *file, unsigned line, const char *function,
+                     LogSeverity severity, const char *format) noexcept
+      : file(file), function(function), format(format), line(line),
+        severity(severity) {}
+
+  CallSite(const CallSite &) = delete;
+  CallSite &operator=(const CallSite &) = delete;
+
+  [[nodiscard]] CallSiteState getState() const noexcept;
+};
+
+namespace detail {
+/// Registers the site, if not already done, and returns its state, see
+/// CallSiteRegistry
+CallSiteState ITST_API registerCallSite(const CallSite &site) noexcept;
+} // namespace detail
+
+inline CallSiteState CallSite::getState() const noexcept {
+  auto ret = state.load(std::memory_order_relaxed);
+  if (ret == CallSiteState::Unregistered) [[unlikely]] {
+    ret = detail::registerCallSite(*this);
+  }
+  return ret;
+}
+} // namespace itst
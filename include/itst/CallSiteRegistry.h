@@ -0,0 +1,40 @@
+#pragma once
+
+#include "itst/CallSite.h"
+#include "itst/Core.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace itst {
+
+/// Selects call-sites by glob patterns ('*' and '?') on their file and
+/// function. The file pattern matches either the full path or the file name.
+struct CallSiteFilter {
+  std::string file = "*";
+  std::string function = "*";
+  /// 0 matches all lines
+  unsigned line = 0;
+
+  [[nodiscard]] bool matches(const CallSite &site) const noexcept;
+};
+
+/// The process-wide list of all call-sites that have been executed so far.
+///
+/// The states set with setState() also apply to the sites that register
+/// later, such that a site can be enabled before it is reached for the first
+/// time. If multiple filters match a site, the one that was set last wins.
+class ITST_API CallSiteRegistry {
+public:
+  /// Sets the state of all matching sites. Returns the number of matching
+  /// sites that are registered already.
+  static size_t setState(const CallSiteFilter &filter, CallSiteState state);
+
+  /// Resets all sites to CallSiteState::Default and forgets all filters.
+  static void reset() noexcept;
+
+  /// The sites that are registered so far.
+  [[nodiscard]] static std::vector<const CallSite *> getCallSites();
+};
+} // namespace itst
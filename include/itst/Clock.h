@@ -0,0 +1,64 @@
+#pragma once
+
+#include "itst/Core.h"
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+
+namespace itst {
+
+/// The clocks that the loggers can take their timestamps from.
+enum class ClockSource : uint8_t {
+  /// CLOCK_REALTIME; exact, but the most expensive
+  Realtime,
+  /// CLOCK_REALTIME_COARSE; only as precise as the scheduler tick (1-4 ms),
+  /// but much cheaper
+  RealtimeCoarse,
+  /// CLOCK_MONOTONIC_COARSE, converted to wall time. Same precision as
+  /// RealtimeCoarse, but never jumps backwards between recalibrations
+  MonotonicCoarse,
+  /// The CPU's time-stamp counter, calibrated against CLOCK_REALTIME. Precise
+  /// and cheap, but only available on x86 CPUs with an invariant TSC
+  Tsc,
+};
+
+/// A raw timestamp that has not been converted to wall time yet, e.g., to
+/// defer the conversion from the logging thread to the writer of the records.
+struct Timestamp {
+  uint64_t ticks{};
+  ClockSource source{};
+};
+
+/// The process-wide clock for the timestamps in the message headers.
+///
+/// The Monotonic and Tsc sources are converted to wall time using a linear
+/// calibration against CLOCK_REALTIME, which is renewed periodically by the
+/// logging threads themselves, see setRecalibrationInterval().
+class ITST_API Clock {
+public:
+  /// Changes the clock source. Falls back to ClockSource::Realtime, if the
+  /// source is not supported on this system; returns whether the source is
+  /// supported. Calibrating the Tsc takes about 10 ms.
+  static bool setSource(ClockSource source) noexcept;
+  [[nodiscard]] static ClockSource getSource() noexcept;
+
+  [[nodiscard]] static bool isSupported(ClockSource source) noexcept;
+
+  /// Sets the interval after which the conversion to wall time is
+  /// recalibrated against CLOCK_REALTIME. Defaults to 1s.
+  static void
+  setRecalibrationInterval(std::chrono::milliseconds interval) noexcept;
+
+  /// Takes a raw timestamp from the current clock source.
+  [[nodiscard]] static Timestamp now() noexcept;
+
+  /// Converts a raw timestamp to wall time.
+  [[nodiscard]] static timespec toRealtime(Timestamp time) noexcept;
+
+  /// Takes the current wall time from the current clock source.
+  [[nodiscard]] static timespec getRealtime() noexcept {
+    return toRealtime(now());
+  }
+};
+} // namespace itst
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "itst/LoggerBase.h"
+#include "itst/RecordBuffer.h"
+
+namespace itst {
+
+/// Writes records into a compressed file.
+///
+/// The records are collected into blocks that are compressed independently on
+/// a background thread and appended to the file as self-contained frames:
+/// zstd frames or LZ4 frames if the respective library is available, gzip
+/// members otherwise. The standard tools (zstdcat, lz4cat, zcat) read such
+/// concatenated frames as one stream, and after a crash the file stays
+/// readable up to the last complete frame.
+///
+/// Blocks are submitted when they are full, on flush(), after a message that
+/// reaches the logger's flush-severity and periodically by the
+/// BackgroundFlusher. If the background thread falls behind by more than a
+/// few blocks, the logging threads wait for it. A block that fails to compress
+/// is dropped, such that the file stays a valid stream of frames (see
+/// getNumDroppedBlocks()).
+class ITST_API CompressedFileSink {
+public:
+  static constexpr size_t DefaultBlockSize = size_t(1) << 20;
+
+  /// Appends to the given file. A level of 0 selects the codec's default
+  /// compression level.
+  explicit CompressedFileSink(const char *file_name,
+                              size_t block_size = DefaultBlockSize,
+                              int level = 0) noexcept;
+  ~CompressedFileSink();
+
+  CompressedFileSink(const CompressedFileSink &) = delete;
+  CompressedFileSink &operator=(const CompressedFileSink &) = delete;
+
+  /// Appends the record to the current block. Submits the block, if it is full
+  /// or, if flush is true, waits until it has been written.
+  void write(std::string_view record, bool flush = false) noexcept;
+
+  /// Submits the current block and waits until all blocks have been written.
+  void flush() noexcept;
+
+  /// The number of blocks that failed to compress and have been dropped.
+  [[nodiscard]] size_t getNumDroppedBlocks() const noexcept;
+
+  /// The name of the codec used, i.e. "zstd", "lz4" or "gzip".
+  [[nodiscard]] static std::string_view getCodecName() noexcept;
+
+private:
+  struct Impl;
+  Impl *impl{};
+};
+
+/// Logs into a CompressedFileSink. Multiple loggers may share the same sink.
+class ITST_API CompressedFileLogger : public LoggerImpl<CompressedFileLogger> {
+public:
+  explicit CompressedFileLogger(CompressedFileSink &sink,
+                                std::string_view class_name,
+                                LogSeverity sev = DefaultSeverity) noexcept
+      : LoggerImpl(class_name, sev), sink(&sink) {}
+
+  void commitRecord(LogSeverity msg_sev) const noexcept {
+    sink->write(RecordBuffer::view(), shouldFlush(msg_sev));
+    RecordBuffer::reset();
+  }
+
+  void flushRecords() const noexcept { sink->flush(); }
+
+private:
+  CompressedFileSink *sink{};
+};
+} // namespace itst
@@ -7,7 +7,20 @@
 #endif
 
 namespace itst {
-class ConsoleLogger : public LoggerImpl<ConsoleLogger> {
+/// See Buffering.h and Sink.h
+enum class BufferMode;
+class StdioSink;
+
+/// Logs into the sink of the console target (see getSink()). Each message is
+/// staged in the calling thread's RecordBuffer and written into the target's
+/// stream with a single locked write.
+///
+/// Uses the ToggleableStreamLock, such that single-threaded programs can turn
+/// off the locking of the console target with setStreamLocking(false). The
+/// BackgroundFlusher skips the console target in the meantime, also after the
+/// logger is destroyed, unless the locking is turned on again before.
+class ConsoleLogger
+    : public LoggerImpl<ConsoleLogger, ToggleableStreamLock> {
   friend LoggerImpl;
 
 public:
@@ -15,9 +28,28 @@ public:
                           LogSeverity sev = DefaultSeverity) noexcept
       : LoggerImpl(class_name, sev) {}
 
-private:
-  [[nodiscard]] FILE *getFileHandle() const noexcept {
-    return ITST_CONSOLE_LOGGER_TARGET;
+  /// Sets the buffering of the console target, see setvbuf. Should be called
+  /// once before the first message is logged.
+  static ITST_API bool setBuffering(BufferMode mode,
+                                    size_t buffer_size = 0) noexcept;
+
+  /// The sink of the console target, e.g., to write records that have been
+  /// formatted elsewhere. Stays valid until the process exits.
+  [[nodiscard]] static ITST_API StdioSink &getSink() noexcept;
+
+  /// Called by the LoggerImpl after each message, see is_record_sink_v
+  void commitRecord(LogSeverity msg_sev) const noexcept {
+    commit(shouldLockStream(), shouldFlush(msg_sev));
   }
+
+  void flushRecords() const noexcept { flushSink(); }
+
+  /// Called by the LoggerImpl, see has_locking_hook_v
+  static ITST_API void lockingChanged(bool lock_stream) noexcept;
+
+private:
+  /// Writes the record of the RecordBuffer into the sink
+  static ITST_API void commit(bool lock_stream, bool flush) noexcept;
+  static ITST_API void flushSink() noexcept;
 };
 } // namespace itst
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "itst/LoggerBase.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace itst {
+
+namespace detail {
+/// The calling thread's rendered context, e.g. "[req=42][user=bob]", or
+/// nullptr once it is destroyed at the thread's exit
+[[nodiscard]] ITST_API std::string *getContextBuffer() noexcept;
+
+/// The OS-level id of the calling thread
+[[nodiscard]] uint64_t ITST_API getThreadId() noexcept;
+
+/// The calling thread's rendered id or name, e.g. "[4711]", or empty once it
+/// is destroyed at the thread's exit
+[[nodiscard]] std::string_view ITST_API getThreadField() noexcept;
+
+struct ContextWriter {
+  std::string *buf{};
+  void operator()(std::string_view content) const { buf->append(content); }
+};
+} // namespace detail
+
+/// Adds a key-value pair to the calling thread's diagnostic context for the
+/// lifetime of this object. The context is printed into the header of all
+/// messages that the thread logs, after the category:
+///
+///   [timestamp][severity][category][key=value]...: content
+///
+/// The value is formatted once when the ScopedContext is created, so logging
+/// only copies the already rendered bytes. ScopedContexts must be destroyed in
+/// reverse order of creation, which is guaranteed when used as local
+/// variables.
+class ScopedContext {
+public:
+  template <typename T>
+  ScopedContext(std::string_view key, const T &value) {
+    auto *buf = detail::getContextBuffer();
+    if (!buf) {
+      return;
+    }
+    prev_size = buf->size();
+    *buf += '[';
+    *buf += key;
+    *buf += '=';
+    LoggerBase::Printer<detail::ContextWriter>{{buf}}(value);
+    *buf += ']';
+  }
+
+  ~ScopedContext() {
+    if (auto *buf = detail::getContextBuffer()) {
+      buf->resize(prev_size);
+    }
+  }
+
+  ScopedContext(const ScopedContext &) = delete;
+  ScopedContext(ScopedContext &&) = delete;
+  ScopedContext &operator=(const ScopedContext &) = delete;
+  ScopedContext &operator=(ScopedContext &&) = delete;
+
+private:
+  size_t prev_size{};
+};
+
+/// Allocates the calling thread's internal buffers of the loggers up front
+/// (the staging buffer of the record sinks, the context and the thread id),
+/// which otherwise happens when the thread logs for the first time, as well as
+/// the process-wide call-site registry. Call this
+/// before the thread enters a section in which it must not allocate, see
+/// ITST_NO_ALLOC.
+void ITST_API preallocateThreadBuffers() noexcept;
+
+/// Sets the name that is printed instead of the thread id for the calling
+/// thread, if LoggerBase::global_print_thread is set.
+void ITST_API setThreadName(std::string_view name);
+} // namespace itst
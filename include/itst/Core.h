@@ -44,3 +44,15 @@
 #else
 #define ITST_ABORT ITST_BUILTIN_TRAP
 #endif
+
+/// Moves a function out of the hot code paths, e.g., into .text.unlikely
+#if defined(__GNUC__)
+#define ITST_COLD __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+#define ITST_COLD __declspec(noinline)
+#else
+#define ITST_COLD
+#endif
+
+#define ITST_CONCAT_IMPL(A, B) A##B
+#define ITST_CONCAT(A, B) ITST_CONCAT_IMPL(A, B)
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "itst/LoggerBase.h"
+#include "itst/RecordBuffer.h"
+
+#include <string_view>
+
+namespace itst {
+
+/// Writes records into a file opened with O_DIRECT, bypassing the page cache,
+/// such that capturing large amounts of logs does not evict the working set
+/// of other processes.
+///
+/// The records are assembled into aligned blocks. There are two blocks: While
+/// the logging threads fill one, a background thread writes the other one.
+/// If the background thread falls behind, the logging threads wait for it.
+///
+/// On flush() (and periodically by the BackgroundFlusher) and on destruction,
+/// the partial last block is written padded to the alignment, and the file is
+/// truncated to the actual length of the records. Appending to an existing
+/// file continues after its last record.
+///
+/// If the file system does not support O_DIRECT (e.g., tmpfs), the file is
+/// written through the page cache instead, and the written ranges are dropped
+/// from it with posix_fadvise.
+class ITST_API DirectFileSink {
+public:
+  static constexpr size_t DefaultBlockSize = size_t(4) << 20;
+  static constexpr size_t Alignment = 4096;
+
+  /// The block size is rounded up to a multiple of the Alignment.
+  explicit DirectFileSink(const char *file_name,
+                          size_t block_size = DefaultBlockSize) noexcept;
+  ~DirectFileSink();
+
+  DirectFileSink(const DirectFileSink &) = delete;
+  DirectFileSink &operator=(const DirectFileSink &) = delete;
+
+  /// Appends the record to the current block and submits the block, when it
+  /// is full.
+  void write(std::string_view record) noexcept;
+
+  /// Writes all pending records to the file.
+  void flush() noexcept;
+
+  /// Whether the file is actually written with O_DIRECT.
+  [[nodiscard]] bool isDirect() const noexcept;
+
+private:
+  struct Impl;
+  Impl *impl{};
+};
+
+/// Logs into a DirectFileSink. Multiple loggers may share the same sink.
+class ITST_API DirectFileLogger : public LoggerImpl<DirectFileLogger> {
+public:
+  explicit DirectFileLogger(DirectFileSink &sink, std::string_view class_name,
+                            LogSeverity sev = DefaultSeverity) noexcept
+      : LoggerImpl(class_name, sev), sink(&sink) {}
+
+  void commitRecord(LogSeverity msg_sev) const noexcept {
+    sink->write(RecordBuffer::view());
+    RecordBuffer::reset();
+    if (shouldFlush(msg_sev)) {
+      sink->flush();
+    }
+  }
+
+  void flushRecords() const noexcept { sink->flush(); }
+
+private:
+  DirectFileSink *sink{};
+};
+} // namespace itst
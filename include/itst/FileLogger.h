@@ -1,9 +1,21 @@
 #pragma once
 
+#include "itst/Buffering.h"
+#include "itst/FileRegistry.h"
+#include "itst/Sink.h"
 #include "LoggerBase.h"
 
 namespace itst {
-class ITST_API FileLogger : public LoggerImpl<FileLogger> {
+/// Appends to the specified file. All FileLoggers that write to the same file
+/// share one file handle and its StdioSink (see FileRegistry). Each message is
+/// staged in the calling thread's RecordBuffer and written into the file's
+/// stream with a single locked write.
+///
+/// Uses the ToggleableStreamLock: setStreamLocking(false) saves locking the
+/// file for each message, if no other thread logs into the same file. The
+/// BackgroundFlusher skips the file in the meantime.
+class ITST_API FileLogger
+    : public LoggerImpl<FileLogger, ToggleableStreamLock> {
 public:
   explicit FileLogger(const char *file_name, std::string_view class_name,
                       LogSeverity sev = DefaultSeverity) noexcept;
@@ -12,9 +24,61 @@ public:
       : FileLogger(file_name.c_str(), class_name, sev) {}
   ~FileLogger();
 
-  [[nodiscard]] FILE *getFileHandle() const noexcept { return file_handle; }
+  FileLogger(const FileLogger &) = delete;
+  FileLogger &operator=(const FileLogger &) = delete;
+
+  /// The sink of the underlying file, which is shared by all FileLoggers that
+  /// write to the same file. Null, if the file could not be opened.
+  [[nodiscard]] StdioSink *getSink() const noexcept { return sink; }
+
+  /// Sets the buffering of the underlying file, see setvbuf. As the file is
+  /// shared, this affects all FileLoggers that write to the same file.
+  /// Should be called before the first message is logged.
+  bool setBuffering(BufferMode mode, size_t buffer_size = 0) noexcept;
+
+  /// Makes the messages with at least the given severity durable: log()
+  /// returns only after they have been written to stable storage (see
+  /// fdatasync). Concurrent threads that wait for durability share a single
+  /// sync of the file. Messages with a lower severity stay buffered.
+  constexpr void setSyncSeverity(std::optional<LogSeverity> sev) noexcept {
+    sync_severity = sev;
+  }
+
+  /// Called by the LoggerImpl after each message, see is_record_sink_v
+  void commitRecord(LogSeverity msg_sev) const noexcept {
+    if (sink) {
+      if (shouldLockStream()) {
+        sink->write(RecordBuffer::view());
+      } else {
+        sink->writeUnlocked(RecordBuffer::view());
+      }
+    }
+    RecordBuffer::reset();
+
+    if (sink && shouldFlush(msg_sev)) {
+      sink->flush();
+    }
+  }
+
+  void flushRecords() const noexcept {
+    if (sink) {
+      sink->flush();
+    }
+  }
+
+  /// Called by the LoggerImpl after each message, see has_sync_hook_v
+  void syncRecord(LogSeverity msg_sev) const noexcept {
+    if (sync_severity && msg_sev >= *sync_severity) {
+      FileRegistry::sync(shared_file);
+    }
+  }
+
+  /// Called by the LoggerImpl, see has_locking_hook_v
+  void lockingChanged(bool lock_stream) const noexcept;
 
 private:
-  FILE *file_handle{};
+  SharedFile *shared_file{};
+  StdioSink *sink{};
+  std::optional<LogSeverity> sync_severity{};
 };
-} // namespace itst
\ No newline at end of file
+} // namespace itst
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "itst/Buffering.h"
+#include "itst/Core.h"
+
+#include <cstddef>
+#include <cstdio>
+
+namespace itst {
+
+/// A reference-counted file handle that is owned by the FileRegistry.
+struct SharedFile;
+class StdioSink;
+
+/// Process-wide registry of the files that are written by FileLoggers.
+///
+/// All FileLoggers whose file names resolve to the same canonical path share
+/// one SharedFile, i.e., one FILE*, one stdio buffer, one lock and one
+/// StdioSink. Hence, records from different loggers never interleave and
+/// opening many categories on the same file does not multiply the buffers and
+/// syscalls.
+class ITST_API FileRegistry {
+public:
+  /// Opens the file for appending, or returns the already opened SharedFile
+  /// for the same path. Returns nullptr, if the file cannot be opened.
+  [[nodiscard]] static SharedFile *acquire(const char *file_name) noexcept;
+
+  /// Drops one reference to the file and closes it, if it was the last one.
+  static void release(SharedFile *file) noexcept;
+
+  [[nodiscard]] static FILE *getFileHandle(const SharedFile *file) noexcept;
+
+  /// The sink through which the FileLoggers write to the file.
+  [[nodiscard]] static StdioSink *getSink(SharedFile *file) noexcept;
+
+  /// Replaces the stdio buffer of the file by one of the given size, which is
+  /// owned by the SharedFile. Affects all loggers writing to this file.
+  static bool setBuffering(SharedFile *file, BufferMode mode,
+                           size_t buffer_size) noexcept;
+
+  /// Flushes the file and writes it to stable storage. Uses group commit: If
+  /// a sync is already running, the caller waits for it to finish and then
+  /// joins the next sync together with all other threads that have arrived
+  /// in the meantime.
+  static void sync(SharedFile *file) noexcept;
+};
+} // namespace itst
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "itst/Core.h"
+#include "itst/common/TypeTraits.h"
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+
+namespace itst {
+
+/// A binary buffer that is logged as contiguous lowercase hex digits, e.g.,
+/// "48656c6c6f". Create it with itst::hex().
+struct HexView {
+  const std::byte *data{};
+  size_t size{};
+};
+
+/// A binary buffer that is logged in the format of `hexdump -C`, i.e., one line
+/// per 16 bytes with the offset, the hex bytes and an ASCII gutter:
+///
+///   00000000  48 65 6c 6c 6f 20 57 6f  72 6c 64 0a 00 01 ...  |Hello World...|
+///
+/// The dump starts on a new line. Create it with itst::hexdump().
+struct HexDump {
+  const std::byte *data{};
+  size_t size{};
+  /// Added to the printed offsets
+  size_t base_offset{};
+};
+
+namespace detail {
+/// Writes 2 * size hex digits to out.
+void ITST_API encodeHex(const std::byte *data, size_t size,
+                        char *out) noexcept;
+
+static constexpr size_t HexDumpBytesPerLine = 16;
+static constexpr size_t HexDumpLineLength =
+    sizeof("00000000  00 00 00 00 00 00 00 00  00 00 00 00 00 00 00 00  "
+           "|0123456789abcdef|") -
+    1;
+
+/// Writes one line of the hexdump for up to HexDumpBytesPerLine bytes to out,
+/// without line-feed. Returns the length of the line.
+size_t ITST_API formatHexDumpLine(const std::byte *data, size_t size,
+                                  size_t offset, char *out) noexcept;
+
+template <typename T, typename = void>
+struct is_byte_container : std::false_type {};
+template <typename T>
+struct is_byte_container<
+    T, std::void_t<decltype(std::data(std::declval<const T &>())),
+                   decltype(std::size(std::declval<const T &>()))>>
+    : std::bool_constant<sizeof(*std::data(std::declval<const T &>())) == 1> {
+};
+
+template <typename Printer> constexpr bool isHexPrintNoexcept() noexcept {
+  return Printer::template isPrintNoexcept<std::string_view>();
+}
+} // namespace detail
+
+[[nodiscard]] inline HexView hex(const void *data, size_t size) noexcept {
+  return {static_cast<const std::byte *>(data), size};
+}
+
+/// Accepts contiguous containers of byte-sized elements, e.g.,
+/// std::vector<uint8_t>, std::array<std::byte, N> or std::string_view.
+template <typename Container,
+          typename = std::enable_if_t<detail::is_byte_container<Container>{}>>
+[[nodiscard]] HexView hex(const Container &buf) noexcept {
+  return hex(std::data(buf), std::size(buf));
+}
+
+[[nodiscard]] inline HexDump hexdump(const void *data, size_t size,
+                                     size_t base_offset = 0) noexcept {
+  return {static_cast<const std::byte *>(data), size, base_offset};
+}
+
+template <typename Container,
+          typename = std::enable_if_t<detail::is_byte_container<Container>{}>>
+[[nodiscard]] HexDump hexdump(const Container &buf,
+                              size_t base_offset = 0) noexcept {
+  return hexdump(std::data(buf), std::size(buf), base_offset);
+}
+
+template <> struct LogTraits<HexView> {
+  static constexpr size_t ChunkSize = 256;
+
+  template <typename Printer>
+  static void printAccordingToType(
+      const HexView &item,
+      Printer printer) noexcept(detail::isHexPrintNoexcept<Printer>()) {
+    // Encode in chunks on the stack, such that no string is allocated
+    std::array<char, 2 * ChunkSize> buf;
+    for (size_t pos = 0; pos < item.size; pos += ChunkSize) {
+      auto len = std::min(ChunkSize, item.size - pos);
+      detail::encodeHex(item.data + pos, len, buf.data());
+      printer(std::string_view(buf.data(), 2 * len));
+    }
+  }
+};
+
+template <> struct LogTraits<HexDump> {
+  template <typename Printer>
+  static void printAccordingToType(
+      const HexDump &item,
+      Printer printer) noexcept(detail::isHexPrintNoexcept<Printer>()) {
+    std::array<char, detail::HexDumpLineLength + 1> buf;
+    for (size_t pos = 0; pos < item.size;
+         pos += detail::HexDumpBytesPerLine) {
+      auto len = detail::formatHexDumpLine(
+          item.data + pos,
+          std::min(detail::HexDumpBytesPerLine, item.size - pos),
+          item.base_offset + pos, buf.data() + 1);
+      buf[0] = '\n';
+      printer(std::string_view(buf.data(), len + 1));
+    }
+  }
+};
+} // namespace itst
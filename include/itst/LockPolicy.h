@@ -0,0 +1,29 @@
+#pragma once
+
+namespace itst {
+
+/// Lock policies, which decide how concurrent writes are synchronized.
+///
+/// The loggers (LoggerImpl) take NoLock, StreamLock or ToggleableStreamLock,
+/// which decide whether their stdio stream is locked (see flockfile) while a
+/// message is written. The sinks (see Sink.h) take NoLock or MutexLock, which
+/// is declared in Sink.h, as it needs <mutex>.
+
+/// Never locks, which saves two atomic read-modify-writes per message. Only
+/// for loggers and sinks whose destination is only ever written by one thread,
+/// e.g., in a tool that never starts a thread, or for sinks that synchronize
+/// by themselves, e.g., with the lock of a stdio stream or with the atomicity
+/// of a single syscall.
+struct NoLock {
+  void lock() noexcept {}
+  void unlock() noexcept {}
+};
+
+/// Locks the logger's stream, such that the messages of concurrent threads do
+/// not interleave. The default policy of the loggers.
+struct StreamLock {};
+
+/// Locks the logger's stream, unless turned off with setStreamLocking(), e.g.,
+/// until the first worker thread starts.
+struct ToggleableStreamLock {};
+} // namespace itst
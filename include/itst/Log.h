@@ -0,0 +1,10 @@
+#pragma once
+
+// The lightweight front header for the files that only log through the
+// ITST_LOG* macros or a ConsoleLogger. Unlike itst/Logger.hpp, it does not
+// pull in the sinks, the buffering API and the iostreams; include
+// itst/OStreamFallback.h to log types that are only printable through
+// operator<<.
+
+#include "itst/ConsoleLogger.h"
+#include "itst/Macros.h"
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "itst/CallSite.h"
+#include "itst/Core.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace itst {
+
+/// The log volume of one call-site
+struct CallSiteVolume {
+  const CallSite *site{};
+  uint64_t num_records{};
+  uint64_t num_bytes{};
+};
+
+enum class VolumeOrder {
+  Bytes,
+  Records,
+};
+
+/// Counts the records and bytes that each ITST_LOG, ITST_LOGF and ITST_ASSERT
+/// call-site produces, e.g., to find the statements that are responsible for
+/// a jump of the log volume.
+///
+/// Only active if built with ITST_ENABLE_LOG_PROFILER (see the cmake option
+/// of the same name); otherwise, the report is empty. Each thread counts into
+/// its own table, so profiling a record costs two inlined increments of
+/// thread-local counters. The logged bytes are measured as they are written, including the
+/// message header.
+class ITST_API LogProfiler {
+public:
+  /// Merges the tables of all threads and returns the call-sites with the
+  /// largest volume since the last reset(), in descending order.
+  [[nodiscard]] static std::vector<CallSiteVolume>
+  getTopCallSites(size_t max_sites,
+                  VolumeOrder order = VolumeOrder::Bytes) noexcept;
+
+  /// Prints a table of the top call-sites, followed by the totals of all
+  /// call-sites.
+  static void printReport(FILE *out = stderr, size_t max_sites = 20,
+                          VolumeOrder order = VolumeOrder::Bytes) noexcept;
+
+  /// Prints the report when the process exits (see atexit).
+  static void reportAtExit(FILE *out = stderr, size_t max_sites = 20,
+                           VolumeOrder order = VolumeOrder::Bytes) noexcept;
+
+  /// Starts counting from zero again.
+  static void reset() noexcept;
+};
+
+namespace detail {
+#ifdef ITST_ENABLE_LOG_PROFILER
+/// The number of bytes that the calling thread has logged so far
+extern thread_local uint64_t profiled_bytes;
+
+/// Only written by the owning thread, so updates need no read-modify-write;
+/// the atomics just make the concurrent reads by the report well-defined
+struct ProfileCounter {
+  std::atomic<uint64_t> num_records{};
+  std::atomic<uint64_t> num_bytes{};
+};
+
+/// The tables are split into chunks that are allocated when a thread logs
+/// from one of their sites for the first time
+constexpr uint32_t ProfileChunkSize = 256;
+constexpr uint32_t MaxProfileChunks = 64;
+/// Sites with larger ids are not profiled
+constexpr uint32_t MaxProfiledSites = ProfileChunkSize * MaxProfileChunks;
+
+using ProfileChunk = std::array<ProfileCounter, ProfileChunkSize>;
+
+/// The chunks of the calling thread's table (MaxProfileChunks of them), or
+/// nullptr before its first profiled record and after the table is destroyed
+extern thread_local std::atomic<ProfileChunk *> *profile_chunks;
+
+/// Creates the calling thread's table or the site's chunk, and counts the
+/// record into it
+void ITST_API profileRecordSlow(const CallSite &site,
+                                uint64_t num_bytes) noexcept;
+
+inline void profileRecord(const CallSite &site, uint64_t num_bytes) noexcept {
+  auto *chunks = profile_chunks;
+  if (chunks && site.id < MaxProfiledSites) {
+    if (auto *chunk = chunks[site.id / ProfileChunkSize].load(
+            std::memory_order_relaxed)) {
+      auto &counter = (*chunk)[site.id % ProfileChunkSize];
+      counter.num_records.store(
+          counter.num_records.load(std::memory_order_relaxed) + 1,
+          std::memory_order_relaxed);
+      counter.num_bytes.store(
+          counter.num_bytes.load(std::memory_order_relaxed) + num_bytes,
+          std::memory_order_relaxed);
+      return;
+    }
+  }
+  profileRecordSlow(site, num_bytes);
+}
+
+/// Attributes the bytes that are logged during its lifetime to the site
+class ProfiledRecord {
+public:
+  explicit ProfiledRecord(const CallSite &site) noexcept
+      : site(site), begin(profiled_bytes) {}
+  ~ProfiledRecord() {
+    if (auto num_bytes = profiled_bytes - begin) {
+      profileRecord(site, num_bytes);
+    }
+  }
+
+  ProfiledRecord(const ProfiledRecord &) = delete;
+  ProfiledRecord &operator=(const ProfiledRecord &) = delete;
+
+private:
+  const CallSite &site;
+  uint64_t begin{};
+};
+#endif // ITST_ENABLE_LOG_PROFILER
+} // namespace detail
+} // namespace itst
@@ -1,8 +1,9 @@
 #pragma once
 
 // This is the main header file of the InsectLogger. You only need to include
-// this.
+// this. See itst/Log.h for a lighter alternative.
 
-#include "itst/ConsoleLogger.h"
-
-#include "itst/Macros.h"
+#include "itst/Buffering.h"
+#include "itst/Log.h"
+#include "itst/OStreamFallback.h"
+#include "itst/Sink.h"
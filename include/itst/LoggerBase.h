@@ -1,31 +1,115 @@
 #pragma once
 
+#include "itst/CallSite.h"
 #include "itst/Core.h"
+#include "itst/LockPolicy.h"
 #include "itst/LogSeverity.h"
+#include "itst/LoggerFwd.h"
+#include "itst/Probes.h"
+#include "itst/RecordBuffer.h"
 #include "itst/common/TemplateString.h"
 #include "itst/common/TypeTraits.h"
 
+#ifdef ITST_ENABLE_LOG_PROFILER
+#include "itst/LogProfiler.h"
+#endif
+
+#include <array>
 #include <cassert>
 #include <charconv>
 #include <cstdio>
+#include <ctime>
 #include <limits>
 #include <optional>
-#include <sstream>
 #include <string_view>
 #include <tuple>
 #include <type_traits>
 #include <utility>
 
+#ifdef __cpp_lib_format
+#include <iterator>
+#endif
+
 namespace itst {
 
+namespace detail {
+/// Prints the types that are only printable through operator<<, see
+/// itst/OStreamFallback.h
+template <typename T> struct OStreamFallback;
+
+#ifdef __cpp_lib_format
+/// Collects the output of std::format_to in a stack buffer and passes it on to
+/// the writer in chunks, such that formatting does not need a std::string.
+template <typename Writer> class FormatBuffer {
+public:
+  /// The output iterator for std::format_to
+  class Iterator {
+  public:
+    using iterator_category = std::output_iterator_tag;
+    using value_type = void;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = void;
+
+    explicit Iterator(FormatBuffer *buf) noexcept : buf(buf) {}
+
+    Iterator &operator*() noexcept { return *this; }
+    Iterator &operator++() noexcept { return *this; }
+    Iterator operator++(int) noexcept { return *this; }
+    Iterator &operator=(char chr) {
+      buf->push(chr);
+      return *this;
+    }
+
+  private:
+    FormatBuffer *buf{};
+  };
+
+  explicit FormatBuffer(Writer writer) noexcept : writer(writer) {}
+
+  [[nodiscard]] Iterator begin() noexcept { return Iterator(this); }
+
+  void push(char chr) {
+    if (len == buf.size()) {
+      flush();
+    }
+    buf[len++] = chr;
+  }
+
+  void flush() {
+    if (len) {
+      writer(std::string_view(buf.data(), len));
+      len = 0;
+    }
+  }
+
+private:
+  Writer writer;
+  std::array<char, 256> buf{};
+  size_t len = 0;
+};
+#endif // __cpp_lib_format
+} // namespace detail
+
 class ITST_API LoggerBase {
 public:
   template <typename U> friend class LogStream;
+  friend class ScopedContext;
 
   static constexpr size_t TabWidth = 4;
 
   static std::optional<LogSeverity> global_enforced_log_severity;
 
+  /// Loggers that have no flush-severity set, flush their stream after each
+  /// message with at least this severity. Not thread-safe, same as
+  /// global_enforced_log_severity.
+  static std::optional<LogSeverity> global_flush_severity;
+
+  /// Print the thread id (or the name set with setThreadName()) into the
+  /// header of each message. Not thread-safe, same as
+  /// global_enforced_log_severity.
+  static bool global_print_thread;
+
   static constexpr size_t getTimestepLength() noexcept {
     return sizeof("2022-11-02 15:10:22.633977") - 1;
   }
@@ -38,6 +122,13 @@ public:
 #endif
       ;
 
+  /// Flushes the stream after each message with at least the given severity,
+  /// e.g., to not lose any errors while keeping large buffers for the rest.
+  /// Overrides global_flush_severity for this logger.
+  constexpr void setFlushSeverity(std::optional<LogSeverity> sev) noexcept {
+    flush_severity = sev;
+  }
+
   template <typename Writer>
   inline static void indent(Writer writer, size_t indent_level) noexcept {
     static constexpr char Indents[] = // NOLINT
@@ -53,43 +144,103 @@ protected:
                                 LogSeverity sev) noexcept
       : class_name(class_name), severity(sev) {}
 
+  /// If force is set, the message is logged regardless of the severity, e.g.,
+  /// for call-sites that have been enabled at runtime.
+  [[nodiscard]] bool shouldLog(LogSeverity msg_sev, bool force) const noexcept {
+    return force || global_enforced_log_severity.value_or(severity) <= msg_sev;
+  }
+
+  [[nodiscard]] bool shouldFlush(LogSeverity msg_sev) const noexcept {
+    auto flush_sev = flush_severity ? flush_severity : global_flush_severity;
+    return flush_sev && msg_sev >= *flush_sev;
+  }
+
+  /// Writes into the stream of a logger (see getFileHandle())
   struct ITST_API FileWriter {
     FILE *file_handle{};
     void operator()(std::string_view content) const noexcept;
   };
 
+  /// Writes into the calling thread's RecordBuffer, for record sinks (see
+  /// is_record_sink_v)
+  struct ITST_API RecordWriter {
+    void operator()(std::string_view content) const noexcept;
+  };
+
   struct ITST_API [[clang::trivial_abi]] FileLock {
 #if defined(_GNU_SOURCE) && !defined(ITST_DISABLE_LOGGER)
     static FileLock create(FILE *file_handle) noexcept;
 
+    /// Same as create(), but does not lock the stream, for streams that no
+    /// other thread writes to concurrently.
+    static FileLock createUnlocked(FILE *file_handle) noexcept {
+      FileLock Lck;
+      Lck.file_handle = file_handle;
+      return Lck;
+    }
+
     FileLock(FileLock &&other) noexcept
-        : file_handle{std::exchange(other.file_handle, nullptr)} {}
+        : file_handle{std::exchange(other.file_handle, nullptr)},
+          locked{std::exchange(other.locked, false)} {}
     FileLock &operator=(FileLock &&other) noexcept {
       std::swap(file_handle, other.file_handle);
+      std::swap(locked, other.locked);
       return *this;
     }
     void destroy() noexcept;
     ~FileLock() {
-      if (file_handle)
+      if (locked)
         destroy();
     }
 #else
-    static FileLock create(FILE *file_handle) noexcept { return {}; }
+    static FileLock create([[maybe_unused]] FILE *file_handle) noexcept {
+      return {};
+    }
+    static FileLock
+    createUnlocked([[maybe_unused]] FILE *file_handle) noexcept {
+      return {};
+    }
 #endif
 
     explicit operator bool() const noexcept { return file_handle != nullptr; }
 
+    [[nodiscard]] FileWriter getWriter() const noexcept {
+      return {file_handle};
+    }
+
     FILE *file_handle{};
 
   private:
     FileLock() noexcept {}
+
+#if defined(_GNU_SOURCE) && !defined(ITST_DISABLE_LOGGER)
+    bool locked{};
+#endif
+  };
+
+  /// The counterpart of the FileLock for record sinks, which is set while a
+  /// record is open in the RecordBuffer. As the RecordBuffer is thread-local,
+  /// there is nothing to lock.
+  struct RecordLock {
+    bool open{};
+
+    explicit operator bool() const noexcept { return open; }
+
+    [[nodiscard]] RecordWriter getWriter() const noexcept { return {}; }
   };
 
   static void flushImpl(FILE *file_handle) noexcept;
+  static void flushUnlocked(FILE *file_handle) noexcept;
 
-  static void printTimestamp(FileWriter writer) noexcept;
+  /// Prints the current time of the Clock. Instantiated for the FileWriter
+  /// and the RecordWriter.
+  template <typename Writer> static void printTimestamp(Writer writer) noexcept;
+  /// Prints a wall time that has been taken before, see Clock::toRealtime()
+  template <typename Writer>
+  static void printTimestamp(Writer writer, timespec current_time) noexcept;
 
-  void printHeader(LogSeverity msg_sev, FileWriter writer) const noexcept;
+  template <typename Writer>
+  void printHeader(LogSeverity msg_sev, Writer writer) const noexcept;
 
   template <typename Writer> struct Printer {
     Writer writer;
@@ -119,6 +270,10 @@ protected:
         return noexcept(std::declval<const T &>().toString());
       } else if constexpr (has_adl_to_string_v<ElemTy>) {
         return is_nothrow_to_string<ElemTy>();
+      } else if constexpr (has_std_formatter_v<ElemTy> &&
+                           !is_iterable_v<ElemTy>) {
+        // std::format_to reports errors by exceptions
+        return false;
       } else if constexpr (is_printable_v<ElemTy>) {
         return false;
       } else if constexpr (is_iterable_v<ElemTy>) {
@@ -152,6 +307,13 @@ protected:
         /// priority NOTE: Explicitly cast to std::string_view, since we now
         /// allow to_string to return sth different than string - it is just
         /// sufficient to be convertible to string_view
+#ifdef ITST_NO_ALLOC
+        static_assert(is_alloc_free_result_v<decltype(adl_to_string(item))>,
+                      "ITST_NO_ALLOC: to_string() of the logged type returns "
+                      "an owning string, which allocates. Return a "
+                      "std::string_view or a reference instead, or "
+                      "specialize itst::LogTraits");
+#endif
         writer(std::string_view(adl_to_string(item)));
       } else if constexpr (std::is_same_v<ElemTy, bool>) {
         writer(item ? "true" : "false");
@@ -170,19 +332,59 @@ protected:
         len = snprintf(buf.data(), buf.size(), Fmt, item);
         writer(std::string_view(buf.data(), len));
       } else if constexpr (has_str_v<ElemTy>) {
+#ifdef ITST_NO_ALLOC
+        static_assert(is_alloc_free_result_v<decltype(item.str())>,
+                      "ITST_NO_ALLOC: str() of the logged type returns an "
+                      "owning string, which allocates. Return a "
+                      "std::string_view or a reference instead, or "
+                      "specialize itst::LogTraits");
+#endif
         writer(item.str());
       } else if constexpr (has_toString_v<ElemTy>) {
+#ifdef ITST_NO_ALLOC
+        static_assert(is_alloc_free_result_v<decltype(item.toString())>,
+                      "ITST_NO_ALLOC: toString() of the logged type returns an "
+                      "owning string, which allocates. Return a "
+                      "std::string_view or a reference instead, or "
+                      "specialize itst::LogTraits");
+#endif
         writer(item.toString());
       } else if constexpr (has_adl_to_string_v<ElemTy>) {
+#ifdef ITST_NO_ALLOC
+        static_assert(is_alloc_free_result_v<decltype(adl_to_string(item))>,
+                      "ITST_NO_ALLOC: to_string() of the logged type returns "
+                      "an owning string, which allocates. Return a "
+                      "std::string_view or a reference instead, or "
+                      "specialize itst::LogTraits");
+#endif
         writer(std::string_view(adl_to_string(item)));
+#ifdef __cpp_lib_format
+      } else if constexpr (has_std_formatter_v<ElemTy> &&
+                           !is_iterable_v<ElemTy>) {
+        // Note: Ranges keep their own, indented format below
+#ifdef ITST_NO_ALLOC
+        static_assert(dependent_false_v<ElemTy>,
+                      "ITST_NO_ALLOC: The logged type is printed through "
+                      "std::formatter, which may allocate, e.g., for "
+                      "locale-specific formatting. Provide a to_string() that "
+                      "returns a std::string_view or specialize "
+                      "itst::LogTraits");
+#endif
+        detail::FormatBuffer<Writer> buf(writer);
+        std::format_to(buf.begin(), "{}", item);
+        buf.flush();
+#endif
       } else if constexpr (is_printable_v<ElemTy>) {
-        std::ostringstream os;
-        os << item;
-#if __cplusplus >= 202002L
-        writer(os.view());
-#else
-        writer(os.str());
+#ifdef ITST_NO_ALLOC
+        static_assert(dependent_false_v<ElemTy>,
+                      "ITST_NO_ALLOC: The logged type is only printable "
+                      "through operator<<, which formats into an "
+                      "std::ostringstream that allocates. Provide a "
+                      "to_string() that returns a std::string_view or "
+                      "specialize itst::LogTraits");
 #endif
+        // If this does not compile, include itst/OStreamFallback.h
+        detail::OStreamFallback<ElemTy>::print(item, writer);
       } else if constexpr (is_iterable_v<ElemTy>) {
         writer("{\n");
         indent_level++;
@@ -223,17 +425,27 @@ protected:
     // }
   };
 
-  FileLock startLogging(FILE *file_handle, LogSeverity msg_sev) const noexcept {
+  /// See shouldLog() for force. If lock_stream is false, the stream is not
+  /// locked while the message is printed.
+  FileLock
+  startLogging([[maybe_unused]] FileWriter writer,
+               [[maybe_unused]] LogSeverity msg_sev,
+               [[maybe_unused]] bool force = false,
+               [[maybe_unused]] bool lock_stream = true) const noexcept {
 #ifndef ITST_DISABLE_LOGGER
 
-    auto actual_sev = global_enforced_log_severity.value_or(severity);
-    bool filter_logging = actual_sev > msg_sev;
-    auto lock = FileLock::create(filter_logging ? nullptr : file_handle);
-    if (filter_logging) {
+    auto *file_handle = writer.file_handle;
+    bool filter_logging = !shouldLog(msg_sev, force);
+    auto lock = lock_stream || filter_logging
+                    ? FileLock::create(filter_logging ? nullptr : file_handle)
+                    : FileLock::createUnlocked(file_handle);
+    // Note: Loggers whose stream cannot be opened pass a null stream
+    if (filter_logging || !lock) {
       return lock;
     }
 
-    printHeader(msg_sev, FileWriter{file_handle});
+    ITST_PROBE_RECORD(record_start, msg_sev, class_name);
+    printHeader(msg_sev, writer);
 
     return lock;
 #else
@@ -241,90 +453,173 @@ protected:
 #endif // ITST_DISABLE_LOGGER
   }
 
-  void endLoggingWithLF(FileLock lock) const noexcept {
+  /// Opens a new record in the RecordBuffer, see RecordBuffer::begin().
+  RecordLock startLogging([[maybe_unused]] RecordWriter writer,
+                          [[maybe_unused]] LogSeverity msg_sev,
+                          [[maybe_unused]] bool force = false,
+                          bool /*lock_stream*/ = false) const noexcept {
 #ifndef ITST_DISABLE_LOGGER
-    if (lock) {
-      FileWriter{lock.file_handle}("\n");
-#if defined(ITST_DEBUG_LOGGING) && (_MSC_VER)
-      flush();
-#endif
+    if (!shouldLog(msg_sev, force)) {
+      return {};
     }
-#endif // ITST_DISABLE_LOGGER
-  }
 
-  void endLogging([[maybe_unused]] FileLock lock) const noexcept {
-#ifndef ITST_DISABLE_LOGGER
-#if defined(ITST_DEBUG_LOGGING) && (_MSC_VER)
-    if (lock) {
-      flush();
-    }
-#endif
+    RecordBuffer::begin();
+    ITST_PROBE_RECORD(record_start, msg_sev, class_name);
+    printHeader(msg_sev, writer);
+    return {true};
+#else
+    return {};
 #endif // ITST_DISABLE_LOGGER
   }
 
-  [[nodiscard]] constexpr Printer<FileWriter>
-  getPrinter(FILE *file_handle) const noexcept {
-    return {{file_handle}};
+  template <typename Writer>
+  using LockFor = std::conditional_t<std::is_same_v<Writer, RecordWriter>,
+                                     RecordLock, FileLock>;
+
+  /// A log item whose type has been erased for the compact logging mode
+  /// (ITST_COMPACT_LOGGING): the call-sites only pack pointers to their items
+  /// together with one print function per type, and the printing happens out
+  /// of line in logErased().
+  template <typename Writer> struct ErasedItem {
+    using PrintFn = void (*)(const void *item, Printer<Writer> &printer);
+
+    const void *item{};
+    PrintFn print{};
+  };
+
+  template <typename Writer, typename T>
+  static void printErased(const void *item, Printer<Writer> &printer) {
+    printer(*static_cast<const T *>(item));
+  }
+  template <typename Writer>
+  static void printErasedCStr(const void *item, Printer<Writer> &printer) {
+    printer.writer(static_cast<const char *>(item));
   }
 
-  template <typename... Ts>
-  void logImpl(FILE *file_handle, LogSeverity msg_sev,
-               const Ts &...log_items) const
-      noexcept((... && Printer<FileWriter>::isPrintNoexcept<Ts>())) {
-#ifndef ITST_DISABLE_LOGGER
-    if (auto lock = startLogging(file_handle, msg_sev)) {
-      auto printer = getPrinter(file_handle);
-      (printer(log_items), ...);
-      FileWriter{file_handle}("\n");
-      endLogging(std::move(lock));
+  template <typename Writer, typename T>
+  [[nodiscard]] static ErasedItem<Writer> eraseItem(const T &item) noexcept {
+    if constexpr (std::is_array_v<T> &&
+                  std::is_convertible_v<const T &, const char *>) {
+      // Don't instantiate a print function per length of string literal
+      return {static_cast<const char *>(item), &printErasedCStr<Writer>};
+    } else {
+      return {&item, &printErased<Writer, T>};
     }
-#endif
   }
 
-  template <typename FormatStringProvider, typename Ts, size_t... I>
-  void internalLogf(FILE *file_handle, LogSeverity msg_sev, Ts log_items_tup,
-                    std::index_sequence<I...>) const {
-
-    static constexpr auto Splits = cxx17::splitFormatString(
-        cxx17::appendLf(cxx17::getCStr<FormatStringProvider>()));
-    static_assert(sizeof...(I) + 1 <= std::tuple_size_v<decltype(Splits)>,
-                  "Not enough format arguments specified");
-    static_assert(sizeof...(I) + 1 >= std::tuple_size_v<decltype(Splits)>,
-                  "Too many format arguments specified");
+  /// Ends a message that has been printed by logErased(); instantiated once
+  /// per logger type.
+  template <typename Writer>
+  using EndLoggingFn = void (*)(const LoggerBase &logger, LockFor<Writer> lock,
+                                LogSeverity msg_sev) noexcept;
 
+  /// The single out-of-line engine of the compact logging mode. Prints the
+  /// header and the items, interleaved with the num_items + 1 parts of the
+  /// format string if fmt_parts is given, and lets end_logging finish the
+  /// message. Instantiated for the FileWriter and the RecordWriter.
+  template <typename Writer>
+  ITST_COLD void logErased(Writer writer, LogSeverity msg_sev, bool force,
+                           bool lock_stream,
+                           const std::string_view *fmt_parts,
+                           const ErasedItem<Writer> *items, size_t num_items,
+                           EndLoggingFn<Writer> end_logging) const;
+
+  void endLogging([[maybe_unused]] FileLock lock,
+                  [[maybe_unused]] LogSeverity msg_sev) const noexcept {
 #ifndef ITST_DISABLE_LOGGER
-    // Note: Wrap the following into an if constexpr, to prevent subsequent
-    // errors after the static_assert
-    if constexpr (sizeof...(I) + 1 == std::tuple_size_v<decltype(Splits)>) {
-      if (auto lock = startLogging(file_handle, msg_sev)) {
-        FileWriter writer{file_handle};
-        constexpr auto WriteNonEmpty = [](auto str, FileWriter writer) {
-          if constexpr (!str.str().empty())
-            writer(str.str());
-        };
-
-        auto printer = getPrinter(file_handle);
-        ((WriteNonEmpty(std::get<I>(Splits), writer),
-          printer(std::get<I>(log_items_tup))),
-         ...);
-
-        WriteNonEmpty(std::get<sizeof...(I)>(Splits), writer);
-        endLogging(std::move(lock));
-      }
+    if (lock && shouldFlush(msg_sev)) {
+      flushUnlocked(lock.file_handle);
+    }
+#if defined(ITST_DEBUG_LOGGING) && (_MSC_VER)
+    if (lock) {
+      flush();
     }
 #endif
+#endif // ITST_DISABLE_LOGGER
+  }
+
+  template <typename Writer>
+  [[nodiscard]] constexpr Printer<Writer>
+  getPrinter(Writer writer) const noexcept {
+    return {writer};
   }
 
   // ---
 
   std::string_view class_name{};
   LogSeverity severity{};
+  std::optional<LogSeverity> flush_severity{};
 };
 
-template <typename U> class LoggerImpl;
+namespace detail {
+/// The state that the lock policy adds to the LoggerImpl; empty unless the
+/// policy needs one
+template <typename LockPolicy> struct LockPolicyState {};
+template <> struct LockPolicyState<ToggleableStreamLock> {
+  bool lock_stream = true;
+};
+} // namespace detail
+
+/// Note: The staging buffers of record sinks (see RecordBuffer) are
+/// thread-local, so they are never locked, regardless of the policy; record
+/// sinks may apply the policy when they commit a record (see
+/// shouldLockStream()). The default policy is declared in LoggerFwd.h.
+template <typename U, typename LockPolicy> class LoggerImpl;
+
+namespace detail {
+template <typename T, typename = void>
+struct is_record_sink : std::false_type {};
+template <typename T>
+struct is_record_sink<
+    T, std::void_t<decltype(std::declval<const T &>().commitRecord(
+                       LogSeverity{})),
+                   decltype(std::declval<const T &>().flushRecords())>>
+    : std::true_type {};
+
+template <typename T, typename = void>
+struct has_sync_hook : std::false_type {};
+template <typename T>
+struct has_sync_hook<T, std::void_t<decltype(std::declval<const T &>()
+                                                 .syncRecord(LogSeverity{}))>>
+    : std::true_type {};
+
+template <typename T, typename = void>
+struct has_locking_hook : std::false_type {};
+template <typename T>
+struct has_locking_hook<
+    T, std::void_t<decltype(std::declval<const T &>().lockingChanged(true))>>
+    : std::true_type {};
+} // namespace detail
+
+/// Record sinks are loggers that do not write into a stream directly, so they
+/// need no getFileHandle(). Instead, each message is written into the calling
+/// thread's RecordBuffer, and commitRecord(msg_sev) is called after it has been
+/// written completely. flush() calls flushRecords().
+template <typename T>
+static constexpr bool is_record_sink_v = detail::is_record_sink<T>::value;
+
+/// The writer of the messages of a logger: Into its RecordBuffer for record
+/// sinks, into its stream otherwise
+template <typename T>
+using WriterFor =
+    std::conditional_t<is_record_sink_v<T>, LoggerBase::RecordWriter,
+                       LoggerBase::FileWriter>;
+
+/// Loggers with a syncRecord(msg_sev) member get it called after each message,
+/// once the stream has been unlocked again. This allows to wait until the
+/// message is on stable storage without blocking the other loggers of the
+/// same stream in the meantime.
+template <typename T>
+static constexpr bool has_sync_hook_v = detail::has_sync_hook<T>::value;
+
+/// Loggers with a lockingChanged(lock_stream) member get it called when
+/// setStreamLocking() turns the locking on or off, e.g., to pause the
+/// BackgroundFlusher for their stream while it is not locked.
+template <typename T>
+static constexpr bool has_locking_hook_v = detail::has_locking_hook<T>::value;
 
 template <typename LoggerT> class LogStream {
-  template <typename U> friend class LoggerImpl;
+  template <typename U, typename LockPolicy> friend class LoggerImpl;
 
 public:
   ~LogStream() noexcept;
@@ -332,43 +627,150 @@ public:
   template <typename T> const LogStream &operator<<(const T &value) const;
 
 private:
-  LogStream(const LoggerImpl<LoggerT> &logger, LogSeverity sev) noexcept;
+  LogStream(const LoggerT &logger, LogSeverity sev) noexcept;
 
   // ---
-  const LoggerImpl<LoggerT> &logger;
-  LoggerBase::FileLock writer;
+  /// The FileLock, or the RecordLock of record sinks
+  using Lock =
+      decltype(std::declval<const LoggerT &>().startLogging(LogSeverity{}));
+
+  const LoggerT &logger;
+  Lock lock;
+  LogSeverity sev;
 };
 
 /// An efficient, lightweight and thread-safe logger.
 /// The only thing not thread-safe is global_enforced_log_severity; however,
 /// it is expected to be set once at the beginning and never changed again.
-template <typename Derived> class LoggerImpl : public LoggerBase {
+///
+/// The LockPolicy (StreamLock, NoLock or ToggleableStreamLock, see
+/// LockPolicy.h) decides whether the stream is locked while a message is
+/// printed.
+template <typename Derived, typename LockPolicy>
+class LoggerImpl : public LoggerBase,
+                   private detail::LockPolicyState<LockPolicy> {
   template <typename U> friend class LogStream;
 
+  static_assert(std::is_same_v<LockPolicy, StreamLock> ||
+                    std::is_same_v<LockPolicy, NoLock> ||
+                    std::is_same_v<LockPolicy, ToggleableStreamLock>,
+                "Unknown lock policy");
+
 public:
   explicit constexpr LoggerImpl(std::string_view class_name,
                                 LogSeverity sev) noexcept
       : LoggerBase(class_name, sev) {}
 
+  /// Turns the locking of the stream on or off. Not thread-safe: Only call
+  /// this while no other thread uses a logger of the same stream.
+  void setStreamLocking(bool lock) noexcept {
+    static_assert(std::is_same_v<LockPolicy, ToggleableStreamLock>,
+                  "Only loggers with the ToggleableStreamLock policy can turn "
+                  "the locking on and off");
+    if (lock == this->lock_stream) {
+      return;
+    }
+    this->lock_stream = lock;
+    if constexpr (has_locking_hook_v<Derived>) {
+      self().lockingChanged(lock);
+    }
+  }
+
   template <typename... Ts>
-  const LoggerImpl &log(LogSeverity msg_sev, const Ts &...log_items) const {
+  const LoggerImpl &log([[maybe_unused]] LogSeverity msg_sev,
+                        [[maybe_unused]] const Ts &...log_items) const {
 #ifndef ITST_DISABLE_LOGGER
-    logImpl(self().getFileHandle(), msg_sev, log_items...);
+    logImpl(msg_sev, /*force=*/false, log_items...);
 #endif
     return *this;
   }
 
   template <typename FormatStringProvider, typename... Ts>
-  const LoggerImpl &logf(FormatStringProvider /*FSP*/, LogSeverity msg_sev,
-                         const Ts &...log_items) const {
+  const LoggerImpl &logf(FormatStringProvider /*FSP*/,
+                         [[maybe_unused]] LogSeverity msg_sev,
+                         [[maybe_unused]] const Ts &...log_items) const {
 #ifndef ITST_DISABLE_LOGGER
     internalLogf<FormatStringProvider>(
-        self().getFileHandle(), msg_sev, std::tie(log_items...),
+        msg_sev, std::tie(log_items...),
         std::make_index_sequence<sizeof...(Ts)>());
 #endif
     return *this;
   }
 
+  /// Logs from the given call-site, if the site is not disabled. Used by
+  /// ITST_LOG.
+  template <typename... Ts>
+  const LoggerImpl &logAt([[maybe_unused]] const CallSite &site,
+                          [[maybe_unused]] LogSeverity msg_sev,
+                          [[maybe_unused]] const Ts &...log_items) const {
+#ifndef ITST_DISABLE_LOGGER
+    ITST_PROBE_SITE(site, class_name);
+    if (auto state = site.getState(); state != CallSiteState::Disabled) {
+#ifdef ITST_ENABLE_LOG_PROFILER
+      detail::ProfiledRecord profiled(site);
+#endif
+      logImpl(msg_sev, state == CallSiteState::Enabled, log_items...);
+    }
+#endif
+    return *this;
+  }
+
+  /// Same as logAt for logf. Used by ITST_LOGF.
+  template <typename FormatStringProvider, typename... Ts>
+  const LoggerImpl &logfAt([[maybe_unused]] const CallSite &site,
+                           FormatStringProvider /*FSP*/,
+                           [[maybe_unused]] LogSeverity msg_sev,
+                           [[maybe_unused]] const Ts &...log_items) const {
+#ifndef ITST_DISABLE_LOGGER
+    ITST_PROBE_SITE(site, class_name);
+    if (auto state = site.getState(); state != CallSiteState::Disabled) {
+#ifdef ITST_ENABLE_LOG_PROFILER
+      detail::ProfiledRecord profiled(site);
+#endif
+      internalLogf<FormatStringProvider>(
+          msg_sev, std::tie(log_items...),
+          std::make_index_sequence<sizeof...(Ts)>(),
+          state == CallSiteState::Enabled);
+    }
+#endif
+    return *this;
+  }
+
+  /// Logs from the given call-site regardless of the logger's severity and of
+  /// the site's state, i.e., even if the site is disabled. Used by ITST_ASSERT,
+  /// whose diagnostics must not be suppressed.
+  template <typename... Ts>
+  const LoggerImpl &forceLogAt([[maybe_unused]] const CallSite &site,
+                               [[maybe_unused]] LogSeverity msg_sev,
+                               [[maybe_unused]] const Ts &...log_items) const {
+#ifndef ITST_DISABLE_LOGGER
+    ITST_PROBE_SITE(site, class_name);
+#ifdef ITST_ENABLE_LOG_PROFILER
+    detail::ProfiledRecord profiled(site);
+#endif
+    logImpl(msg_sev, /*force=*/true, log_items...);
+#endif
+    return *this;
+  }
+
+  /// Same as forceLogAt for logf. Used by ITST_ASSERTF.
+  template <typename FormatStringProvider, typename... Ts>
+  const LoggerImpl &forceLogfAt([[maybe_unused]] const CallSite &site,
+                                FormatStringProvider /*FSP*/,
+                                [[maybe_unused]] LogSeverity msg_sev,
+                                [[maybe_unused]] const Ts &...log_items) const {
+#ifndef ITST_DISABLE_LOGGER
+    ITST_PROBE_SITE(site, class_name);
+#ifdef ITST_ENABLE_LOG_PROFILER
+    detail::ProfiledRecord profiled(site);
+#endif
+    internalLogf<FormatStringProvider>(
+        msg_sev, std::tie(log_items...),
+        std::make_index_sequence<sizeof...(Ts)>(), /*force=*/true);
+#endif
+    return *this;
+  }
+
   template <typename... Ts>
   const LoggerImpl &logTrace(const Ts &...log_items) const {
     return log(LogSeverity::Trace, log_items...);
@@ -396,12 +798,16 @@ public:
 
   void flush() const noexcept {
 #ifndef ITST_DISABLE_LOGGER
-    flushImpl(self().getFileHandle());
+    if constexpr (is_record_sink_v<Derived>) {
+      self().flushRecords();
+    } else {
+      flushImpl(self().getFileHandle());
+    }
 #endif
   }
 
   [[nodiscard]] LogStream<Derived> stream(LogSeverity sev) const noexcept {
-    return {*this, sev};
+    return {self(), sev};
   }
 
   // template <typename T> static std::string log_string(const T &item) { //
@@ -412,9 +818,167 @@ public:
   //  }); return ret;
   //}
 
+protected:
+  /// Whether the LockPolicy requires to lock the stream. Record sinks, whose
+  /// staging buffer needs no lock, may use it when committing their records.
+  [[nodiscard]] constexpr bool shouldLockStream() const noexcept {
+    if constexpr (std::is_same_v<LockPolicy, NoLock>) {
+      return false;
+    } else if constexpr (std::is_same_v<LockPolicy, ToggleableStreamLock>) {
+      return this->lock_stream;
+    } else {
+      return true;
+    }
+  }
+
 private:
-  [[nodiscard]] FileLock startLogging(LogSeverity msg_sev) const noexcept {
-    return this->LoggerBase::startLogging(self().getFileHandle(), msg_sev);
+  /// The writer of the messages (see WriterFor): Into the stream of
+  /// getFileHandle(), or, for record sinks, into the calling thread's
+  /// RecordBuffer. Only resolved once a message passed shouldLog(), as
+  /// getFileHandle() may open the stream.
+  [[nodiscard]] auto getWriter() const noexcept {
+    if constexpr (is_record_sink_v<Derived>) {
+      return RecordWriter{};
+    } else {
+      return FileWriter{self().getFileHandle()};
+    }
+  }
+
+  [[nodiscard]] auto startLogging(LogSeverity msg_sev) const noexcept {
+    return startLogging(shouldLog(msg_sev, /*force=*/false)
+                            ? getWriter()
+                            : WriterFor<Derived>{},
+                        msg_sev);
+  }
+
+  template <typename Writer>
+  [[nodiscard]] LockFor<Writer>
+  startLogging(Writer writer, LogSeverity msg_sev,
+               bool force = false) const noexcept {
+    return this->LoggerBase::startLogging(writer, msg_sev, force,
+                                          shouldLockStream());
+  }
+
+  template <typename Lock>
+  void endLoggingWithLF([[maybe_unused]] Lock lock,
+                        [[maybe_unused]] LogSeverity msg_sev) const noexcept {
+#ifndef ITST_DISABLE_LOGGER
+    if (lock) {
+      lock.getWriter()("\n");
+      endLogging(std::move(lock), msg_sev);
+    }
+#endif // ITST_DISABLE_LOGGER
+  }
+
+  template <typename Lock>
+  void endLogging([[maybe_unused]] Lock lock,
+                  [[maybe_unused]] LogSeverity msg_sev) const noexcept {
+#ifndef ITST_DISABLE_LOGGER
+    [[maybe_unused]] bool logged = bool(lock);
+    [[maybe_unused]] std::string_view record;
+    if constexpr (is_record_sink_v<Derived>) {
+      // Record sinks take the complete message from their staging buffer
+      if (lock) {
+#ifdef ITST_HAS_USDT_PROBES
+        // Note: The staging buffer keeps the record after the commit, until
+        // the thread writes the next one
+        record = RecordBuffer::view();
+#endif
+        self().commitRecord(msg_sev);
+      }
+    } else {
+      this->LoggerBase::endLogging(std::move(lock), msg_sev);
+    }
+
+    if (logged) {
+      ITST_PROBE_RECORD_COMMITTED(msg_sev, class_name, record);
+      if constexpr (has_sync_hook_v<Derived>) {
+        self().syncRecord(msg_sev);
+      }
+    }
+#endif // ITST_DISABLE_LOGGER
+  }
+
+  template <typename... Ts>
+  void logImpl(LogSeverity msg_sev, bool force, const Ts &...log_items) const
+      noexcept((... && Printer<WriterFor<Derived>>::
+                           template isPrintNoexcept<Ts>())) {
+#ifndef ITST_DISABLE_LOGGER
+    if (!shouldLog(msg_sev, force)) {
+      return;
+    }
+    // Note: force skips checking the severity again
+    auto writer = getWriter();
+#ifdef ITST_COMPACT_LOGGING
+    using Writer = decltype(writer);
+    const std::array<ErasedItem<Writer>, sizeof...(Ts)> items = {
+        eraseItem<Writer>(log_items)...};
+    logErased(writer, msg_sev, /*force=*/true, shouldLockStream(), nullptr,
+              items.data(), items.size(), &endLoggingErased<Writer>);
+#else
+    if (auto lock = startLogging(writer, msg_sev, /*force=*/true)) {
+      auto printer = getPrinter(writer);
+      (printer(log_items), ...);
+      writer("\n");
+      endLogging(std::move(lock), msg_sev);
+    }
+#endif // ITST_COMPACT_LOGGING
+#endif // ITST_DISABLE_LOGGER
+  }
+
+  template <typename FormatStringProvider, typename Ts, size_t... I>
+  void internalLogf(LogSeverity msg_sev, Ts log_items_tup,
+                    std::index_sequence<I...>, bool force = false) const {
+
+    static constexpr auto Splits = cxx17::splitFormatString(
+        cxx17::appendLf(cxx17::getCStr<FormatStringProvider>()));
+    static_assert(sizeof...(I) + 1 <= std::tuple_size_v<decltype(Splits)>,
+                  "Not enough format arguments specified");
+    static_assert(sizeof...(I) + 1 >= std::tuple_size_v<decltype(Splits)>,
+                  "Too many format arguments specified");
+
+#ifndef ITST_DISABLE_LOGGER
+    // Note: Wrap the following into an if constexpr, to prevent subsequent
+    // errors after the static_assert
+    if constexpr (sizeof...(I) + 1 == std::tuple_size_v<decltype(Splits)>) {
+      if (!shouldLog(msg_sev, force)) {
+        return;
+      }
+      // Note: force skips checking the severity again
+      auto writer = getWriter();
+      using Writer = decltype(writer);
+#ifdef ITST_COMPACT_LOGGING
+      static constexpr std::string_view Parts[] = {
+          std::get<I>(Splits).str()..., std::get<sizeof...(I)>(Splits).str()};
+      const std::array<ErasedItem<Writer>, sizeof...(I)> items = {
+          eraseItem<Writer>(std::get<I>(log_items_tup))...};
+      logErased(writer, msg_sev, /*force=*/true, shouldLockStream(), Parts,
+                items.data(), items.size(), &endLoggingErased<Writer>);
+#else
+      if (auto lock = startLogging(writer, msg_sev, /*force=*/true)) {
+        constexpr auto WriteNonEmpty = [](auto str, Writer writer) {
+          if constexpr (!str.str().empty())
+            writer(str.str());
+        };
+
+        auto printer = getPrinter(writer);
+        ((WriteNonEmpty(std::get<I>(Splits), writer),
+          printer(std::get<I>(log_items_tup))),
+         ...);
+
+        WriteNonEmpty(std::get<sizeof...(I)>(Splits), writer);
+        endLogging(std::move(lock), msg_sev);
+      }
+#endif // ITST_COMPACT_LOGGING
+    }
+#endif
+  }
+
+  template <typename Writer>
+  static void endLoggingErased(const LoggerBase &logger, LockFor<Writer> lock,
+                               LogSeverity msg_sev) noexcept {
+    static_cast<const LoggerImpl &>(logger).endLogging(std::move(lock),
+                                                       msg_sev);
   }
 
   [[nodiscard]] constexpr const Derived &self() const noexcept {
@@ -423,23 +987,23 @@ private:
 };
 
 template <typename LoggerT> inline LogStream<LoggerT>::~LogStream() noexcept {
-  logger.endLoggingWithLF(std::move(writer));
+  logger.endLoggingWithLF(std::move(lock), sev);
 }
 
 template <typename LoggerT>
 template <typename T>
 inline const itst::LogStream<LoggerT> &
-LogStream<LoggerT>::operator<<(const T &value) const {
+LogStream<LoggerT>::operator<<([[maybe_unused]] const T &value) const {
 #ifndef ITST_DISABLE_LOGGER
-  if (writer)
-    logger.getPrinter(writer.file_handle)(value);
+  if (lock)
+    logger.getPrinter(lock.getWriter())(value);
 #endif
   return *this;
 }
 
 template <typename LoggerT>
-inline LogStream<LoggerT>::LogStream(const LoggerImpl<LoggerT> &logger,
+inline LogStream<LoggerT>::LogStream(const LoggerT &logger,
                                      LogSeverity sev) noexcept
-    : logger(logger), writer(logger.startLogging(sev)) {}
+    : logger(logger), lock(logger.startLogging(sev)), sev(sev) {}
 
 } // namespace itst
@@ -0,0 +1,31 @@
+#pragma once
+
+// Forward declarations of the loggers, e.g., for headers that only pass
+// loggers around. Include the header of the logger (or itst/Log.h) in the
+// files that actually log.
+
+namespace itst {
+enum class LogSeverity;
+
+class LoggerBase;
+
+/// Lock policies of the LoggerImpl, see LockPolicy.h
+struct NoLock;
+struct StreamLock;
+struct ToggleableStreamLock;
+
+template <typename U, typename LockPolicy = StreamLock> class LoggerImpl;
+template <typename LoggerT> class LogStream;
+
+class ConsoleLogger;
+class FileLogger;
+class ShardedFileLogger;
+template <typename LockPolicy = StreamLock> class BasicStringLogger;
+using StringLogger = BasicStringLogger<>;
+class TraceLogger;
+class CompressedFileLogger;
+class DirectFileLogger;
+class SharedMemoryLogger;
+class UnixSocketLogger;
+template <typename SinkT> class SinkLogger;
+} // namespace itst
@@ -13,7 +13,17 @@
 #define ITST_LOGGER_CAT_SEV(CAT, SEV)                                          \
   static constexpr ::itst::ConsoleLogger logger(CAT, ::itst::LogSeverity::SEV)
 
-#define ITST_LOG(SEV, ...) logger.log(::itst::LogSeverity::SEV, __VA_ARGS__)
+/// Declares the static descriptor of a log statement, see CallSite
+#define ITST_CALL_SITE(SEV, FMT)                                               \
+  static const ::itst::CallSite itst_call_site {                               \
+    __FILE__, __LINE__, __func__, ::itst::LogSeverity::SEV, FMT                \
+  }
+
+#define ITST_LOG(SEV, ...)                                                     \
+  do {                                                                         \
+    ITST_CALL_SITE(SEV, #__VA_ARGS__);                                         \
+    logger.logAt(itst_call_site, ::itst::LogSeverity::SEV, __VA_ARGS__);       \
+  } while (false)
 
 #define ITST_FMT(FMT)                                                          \
   [] {                                                                         \
@@ -23,7 +33,11 @@
     return Fmt{};                                                              \
   }()
 #define ITST_LOGF(SEV, FMT, ...)                                               \
-  logger.logf(ITST_FMT(FMT), ::itst::LogSeverity::SEV, ##__VA_ARGS__)
+  do {                                                                         \
+    ITST_CALL_SITE(SEV, FMT);                                                  \
+    logger.logfAt(itst_call_site, ITST_FMT(FMT), ::itst::LogSeverity::SEV,     \
+                  ##__VA_ARGS__);                                              \
+  } while (false)
 
 #define ITST_LOGGER_LOG(SEV, ...)                                              \
   do {                                                                         \
@@ -43,44 +57,67 @@
 #ifndef ITST_DISABLE_ASSERT
 
 namespace itst::detail {
-template <typename LoggerT, typename... Msg>
-static inline void assertFailMessage(const LoggerImpl<LoggerT> &logger,
-                                     const char *file, unsigned line,
-                                     const Msg &...m) {
+template <typename LoggerT, typename LockPolicy, typename... Msg>
+static inline void
+assertFailMessage(const LoggerImpl<LoggerT, LockPolicy> &logger,
+                  const CallSite &site, const char *file, unsigned line,
+                  const Msg &...m) {
   if constexpr (sizeof...(Msg) != 0) {
-    logger.log(LogSeverity::Fatal, file, ":", line, ": note: ", m...);
+    logger.forceLogAt(site, LogSeverity::Fatal, file, ":", line, ": note: ",
+                      m...);
   }
 }
 
-template <typename LoggerT, typename Fmt, typename... Msg>
-static inline void assertFailMessagef(const LoggerImpl<LoggerT> &logger, Fmt f,
-                                      const char *file, unsigned line,
-                                      const Msg &...m) {
+template <typename LoggerT, typename LockPolicy, typename Fmt,
+          typename... Msg>
+static inline void
+assertFailMessagef(const LoggerImpl<LoggerT, LockPolicy> &logger,
+                   const CallSite &site, Fmt f, const char *file,
+                   unsigned line, const Msg &...m) {
   if constexpr (sizeof...(Msg) != 0) {
-    logger.logf(f, LogSeverity::Fatal, file, line, m...);
+    logger.forceLogfAt(site, f, LogSeverity::Fatal, file, line, m...);
   }
 }
+
+/// Runs the failure branch of an assertion out of line, such that it does not
+/// take up space in the instruction cache of the asserting function
+template <typename FailFn>
+[[noreturn]] ITST_COLD void assertFail(const FailFn &fail_fn) noexcept {
+  fail_fn();
+  ITST_ABORT;
+}
 } // namespace itst::detail
 
+// Note: The call-site is declared outside of the lambda, such that it keeps
+// the name of the asserting function. The diagnostics are forced, i.e., they
+// are logged even if the call-site has been disabled
 #define ITST_ASSERT(X, ...)                                                    \
   do {                                                                         \
+    ITST_CALL_SITE(Fatal, "Assertion failed: " #X);                            \
     if (!(X)) [[unlikely]] {                                                   \
-      ITST_LOG(Fatal, __FILE__, ":", __LINE__, ": Assertion failed: ", #X);    \
-      ::itst::detail::assertFailMessage(logger, __FILE__, __LINE__,            \
-                                        ##__VA_ARGS__);                        \
-      ITST_LOG_FLUSH();                                                        \
-      ITST_ABORT;                                                              \
+      ::itst::detail::assertFail([&] {                                         \
+        logger.forceLogAt(itst_call_site, ::itst::LogSeverity::Fatal,          \
+                          __FILE__, ":", __LINE__, ": Assertion failed: ",     \
+                          #X);                                                 \
+        ::itst::detail::assertFailMessage(logger, itst_call_site, __FILE__,    \
+                                          __LINE__, ##__VA_ARGS__);            \
+        ITST_LOG_FLUSH();                                                      \
+      });                                                                      \
     }                                                                          \
   } while (false)
 #define ITST_ASSERTF(X, FMT, ...)                                              \
   do {                                                                         \
+    ITST_CALL_SITE(Fatal, "Assertion failed: " #X);                            \
     if (!(X)) [[unlikely]] {                                                   \
-      ITST_LOG(Fatal, __FILE__, ":", __LINE__, ": Assertion failed: ", #X);    \
-      ::itst::detail::assertFailMessagef(logger,                               \
-                                         ITST_FMT("{}:{}: note: " FMT),        \
-                                         __FILE__, __LINE__, ##__VA_ARGS__);   \
-      ITST_LOG_FLUSH();                                                        \
-      ITST_ABORT;                                                              \
+      ::itst::detail::assertFail([&] {                                         \
+        logger.forceLogAt(itst_call_site, ::itst::LogSeverity::Fatal,          \
+                          __FILE__, ":", __LINE__, ": Assertion failed: ",     \
+                          #X);                                                 \
+        ::itst::detail::assertFailMessagef(                                    \
+            logger, itst_call_site, ITST_FMT("{}:{}: note: " FMT), __FILE__,   \
+            __LINE__, ##__VA_ARGS__);                                          \
+        ITST_LOG_FLUSH();                                                      \
+      });                                                                      \
     }                                                                          \
   } while (false)
 #define ITST_LOGGER_ASSERT(X, ...)                                             \
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "itst/Core.h"
+#include "itst/LogSeverity.h"
+#include "itst/LoggerBase.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+namespace itst {
+
+enum class MetricKind {
+  Timer,
+  Counter,
+};
+
+/// Identifies a metric by its name. Created once per call-site of
+/// ITST_SCOPE_TIMER and ITST_COUNT; all call-sites with the same name share the
+/// same metric.
+class ITST_API MetricId {
+public:
+  MetricId(std::string_view name, MetricKind kind) noexcept;
+
+  [[nodiscard]] uint32_t getId() const noexcept { return id; }
+
+private:
+  uint32_t id{};
+};
+
+namespace detail {
+void ITST_API recordDuration(const MetricId &metric, uint64_t nanos) noexcept;
+void ITST_API addToCounter(const MetricId &metric, uint64_t num) noexcept;
+} // namespace detail
+
+/// Measures the time from construction to destruction and records it in the
+/// calling thread's histogram for the metric.
+class ScopedTimer {
+public:
+  explicit ScopedTimer(const MetricId &metric) noexcept
+      : metric(metric), start(std::chrono::steady_clock::now()) {}
+
+  ~ScopedTimer() {
+    auto duration = std::chrono::steady_clock::now() - start;
+    detail::recordDuration(
+        metric,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+  }
+
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+  const MetricId &metric;
+  std::chrono::steady_clock::time_point start;
+};
+
+/// Periodically merges the per-thread timers and counters and logs one summary
+/// record per interval, containing the count and percentiles of each timer and
+/// the increment of each counter within that interval.
+class ITST_API MetricsReporter {
+public:
+  using EmitFn = void (*)(const void *logger, LogSeverity sev,
+                          std::string_view summary);
+
+  /// Starts the background thread, or changes the logger and interval, if it
+  /// is already running. The logger must outlive the reporter.
+  template <typename LoggerT, typename LockPolicy>
+  static void start(const LoggerImpl<LoggerT, LockPolicy> &logger,
+                    std::chrono::milliseconds interval,
+                    LogSeverity sev = LogSeverity::Info) noexcept {
+    startImpl(
+        &logger,
+        [](const void *logger, LogSeverity sev, std::string_view summary) {
+          static_cast<const LoggerImpl<LoggerT, LockPolicy> *>(logger)->log(
+              sev, "metrics: ", summary);
+        },
+        interval, sev);
+  }
+
+  /// Stops the background thread after reporting one last time.
+  static void stop() noexcept;
+
+  /// Reports the metrics since the last report immediately.
+  static void report() noexcept;
+
+private:
+  static void startImpl(const void *logger, EmitFn emit,
+                        std::chrono::milliseconds interval,
+                        LogSeverity sev) noexcept;
+};
+} // namespace itst
+
+#ifndef ITST_DISABLE_LOGGER
+
+/// Measures the time until the end of the enclosing scope
+#define ITST_SCOPE_TIMER(NAME)                                                 \
+  static const ::itst::MetricId ITST_CONCAT(itst_timer_id_, __LINE__){         \
+      NAME, ::itst::MetricKind::Timer};                                        \
+  const ::itst::ScopedTimer ITST_CONCAT(itst_timer_, __LINE__) {               \
+    ITST_CONCAT(itst_timer_id_, __LINE__)                                      \
+  }
+
+/// Adds NUM to the counter
+#define ITST_COUNT(NAME, NUM)                                                  \
+  do {                                                                         \
+    static const ::itst::MetricId itst_counter_id{                             \
+        NAME, ::itst::MetricKind::Counter};                                    \
+    ::itst::detail::addToCounter(itst_counter_id, (NUM));                      \
+  } while (false)
+
+#else // ITST_DISABLE_LOGGER
+
+#define ITST_SCOPE_TIMER(NAME)                                                 \
+  do {                                                                         \
+  } while (false)
+#define ITST_COUNT(NAME, NUM)                                                  \
+  do {                                                                         \
+  } while (false)
+
+#endif // ITST_DISABLE_LOGGER
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "itst/LoggerBase.h"
+
+#include <sstream>
+
+// Makes the types loggable that are only printable through
+// operator<<(std::ostream&, const T&), e.g., pointers. Not included by
+// itst/Log.h, as it pulls in the iostreams; itst/Logger.hpp includes it.
+
+namespace itst::detail {
+template <typename T> struct OStreamFallback {
+  template <typename Writer> static void print(const T &item, Writer writer) {
+    std::ostringstream os;
+    os << item;
+#if __cplusplus >= 202002L
+    writer(os.view());
+#else
+    writer(os.str());
+#endif
+  }
+};
+} // namespace itst::detail
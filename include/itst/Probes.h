@@ -0,0 +1,63 @@
+#pragma once
+
+/// USDT probes (see sys/sdt.h of SystemTap) for external tracers like perf or
+/// bpftrace, e.g.:
+///
+///   bpftrace -e 'usdt:./app:insect_logger:site /arg0 == 1/ {
+///     printf("%s:%d\n", str(arg4), arg5); }'
+///
+/// Only active if built with ITST_ENABLE_USDT_PROBES (see the cmake option of
+/// the same name) and sys/sdt.h is available; otherwise, the probes expand to
+/// nothing. An inactive probe costs a single nop, plus keeping its arguments
+/// in registers.
+///
+/// The probes of the provider insect_logger are:
+///   site(severity, category, category_len, format, file, line)
+///     Each execution of an ITST_LOG or ITST_LOGF statement, before the
+///     statement is filtered by its severity. format is the CallSite's format.
+///   record_start(severity, category, category_len)
+///     A record passed the severity filter and is about to be printed.
+///   lock_wait(file_handle) and lock_acquired(file_handle)
+///     Before and after locking the stream of a record, i.e., the difference
+///     is the time spent waiting in flockfile.
+///   record_committed(severity, category, category_len, record, record_len)
+///     A record has been written completely (and committed to its sink).
+///     record is the complete record, including its header and the trailing
+///     line feed, if the logger is a record sink (see is_record_sink_v);
+///     loggers that print into a stream pass nullptr and 0.
+
+#if defined(ITST_ENABLE_USDT_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define ITST_HAS_USDT_PROBES
+#endif
+#endif
+
+#ifdef ITST_HAS_USDT_PROBES
+#define ITST_PROBE1(NAME, A1) DTRACE_PROBE1(insect_logger, NAME, A1)
+#define ITST_PROBE3(NAME, A1, A2, A3)                                          \
+  DTRACE_PROBE3(insect_logger, NAME, A1, A2, A3)
+#define ITST_PROBE5(NAME, A1, A2, A3, A4, A5)                                  \
+  DTRACE_PROBE5(insect_logger, NAME, A1, A2, A3, A4, A5)
+#define ITST_PROBE6(NAME, A1, A2, A3, A4, A5, A6)                              \
+  DTRACE_PROBE6(insect_logger, NAME, A1, A2, A3, A4, A5, A6)
+#else
+#define ITST_PROBE1(NAME, A1) ((void)0)
+#define ITST_PROBE3(NAME, A1, A2, A3) ((void)0)
+#define ITST_PROBE5(NAME, A1, A2, A3, A4, A5) ((void)0)
+#define ITST_PROBE6(NAME, A1, A2, A3, A4, A5, A6) ((void)0)
+#endif
+
+/// The arguments of the record probes
+#define ITST_PROBE_RECORD(NAME, SEV, CATEGORY)                                 \
+  ITST_PROBE3(NAME, int(SEV), (CATEGORY).data(), (CATEGORY).size())
+
+/// Fires the record_committed probe, RECORD is a std::string_view
+#define ITST_PROBE_RECORD_COMMITTED(SEV, CATEGORY, RECORD)                     \
+  ITST_PROBE5(record_committed, int(SEV), (CATEGORY).data(),                   \
+              (CATEGORY).size(), (RECORD).data(), (RECORD).size())
+
+/// Fires the site probe for a CallSite
+#define ITST_PROBE_SITE(SITE, CATEGORY)                                        \
+  ITST_PROBE6(site, int((SITE).severity), (CATEGORY).data(),                   \
+              (CATEGORY).size(), (SITE).format, (SITE).file, (SITE).line)
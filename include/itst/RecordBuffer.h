@@ -0,0 +1,40 @@
+#pragma once
+
+#include "itst/Core.h"
+
+#include <string_view>
+
+namespace itst {
+
+/// Per-thread staging buffer for record sinks (see is_record_sink_v).
+///
+/// Each message is first written completely into the calling thread's staging
+/// buffer and then handed to the sink as a whole. The buffer is plain memory,
+/// i.e., the records of sinks never pass through stdio, and as it is only ever
+/// used by one thread, the LoggerImpl never locks it.
+///
+/// All record sinks in a thread share the same staging buffer. Records may
+/// nest, e.g., if an item's to_string() logs itself, or while a LogStream is
+/// held: The LoggerImpl opens each record with begin(), and the nested record
+/// is appended after the unfinished outer one and removed again on reset().
+class ITST_API RecordBuffer {
+public:
+  /// Allocates the calling thread's staging buffer, which otherwise happens
+  /// when the thread logs into a record sink for the first time.
+  static void preallocate() noexcept;
+
+  /// Opens a new record at the current end of the calling thread's staging
+  /// buffer.
+  static void begin() noexcept;
+
+  /// Appends to the innermost open record.
+  static void write(std::string_view content) noexcept;
+
+  /// Returns the innermost open record of the calling thread's staging
+  /// buffer. The view is invalidated by the next write.
+  [[nodiscard]] static std::string_view view() noexcept;
+
+  /// Discards the innermost open record and closes it.
+  static void reset() noexcept;
+};
+} // namespace itst
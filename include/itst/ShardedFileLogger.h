@@ -0,0 +1,49 @@
+#pragma once
+
+#include "LoggerBase.h"
+
+#include <string>
+
+namespace itst {
+/// Writes the messages of each thread into a file of its own, named
+/// "<base_name>.<tid>.log", such that logging threads never contend for a
+/// shared stream. All ShardedFileLoggers with the same base name share the
+/// shards.
+///
+/// The calling thread's shard is opened when the thread first logs a message
+/// that passes the severity through a logger of the base name, and closed
+/// when the thread exits. As only the
+/// owning thread writes to a shard, the stream is never locked (see
+/// NoLock). Messages that a thread logs while its thread_local objects
+/// are destroyed are dropped.
+///
+/// The BackgroundFlusher does not flush the shards, as only the owning thread
+/// may touch them. If the process crashes, each thread loses the unflushed
+/// part of its shard's buffer (up to BUFSIZ bytes).
+///
+/// Use itst-merge to merge the shards into one file that is ordered by the
+/// timestamps of the messages.
+class ITST_API ShardedFileLogger
+    : public LoggerImpl<ShardedFileLogger, NoLock> {
+public:
+  explicit ShardedFileLogger(const char *base_name,
+                             std::string_view class_name,
+                             LogSeverity sev = DefaultSeverity) noexcept;
+  explicit ShardedFileLogger(const std::string &base_name,
+                             std::string_view class_name,
+                             LogSeverity sev = DefaultSeverity) noexcept
+      : ShardedFileLogger(base_name.c_str(), class_name, sev) {}
+
+  /// The shard of the calling thread, which is opened on the first call. Null,
+  /// if it cannot be opened.
+  [[nodiscard]] FILE *getFileHandle() const noexcept;
+
+  /// Flushes the shard of the calling thread. The shards of the other threads
+  /// are flushed when they exit.
+  void flush() const noexcept;
+
+private:
+  /// The index of the base name in the registry of the shards
+  size_t base_id{};
+};
+} // namespace itst
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "itst/LoggerBase.h"
+#include "itst/RecordBuffer.h"
+
+#include <cstdint>
+#include <string_view>
+
+namespace itst {
+
+/// A multi-producer ring buffer of records in POSIX shared memory, which is
+/// drained by a separate process, e.g., itst-collector.
+///
+/// The logging threads of any number of processes reserve space for each
+/// record with a single compare-and-swap on the ring's write position and
+/// never block: if the collector falls behind, e.g., because its disk is
+/// stuck, the records are dropped and counted. As the shared memory outlives
+/// the producing processes, the records that are in the ring when a producer
+/// crashes are still written by the collector.
+///
+/// Each record gets a sequence number. The numbers of one ring are
+/// consecutive, apart from the dropped records, but records of concurrent
+/// producers may be read slightly out of sequence order.
+class ITST_API SharedMemoryRing {
+public:
+  static constexpr size_t DefaultCapacity = size_t(4) << 20;
+
+  using ReadFn = void (*)(void *context, uint64_t seq,
+                          std::string_view record) noexcept;
+
+  /// Opens the ring with the given name (see shm_open), or creates it with
+  /// the given capacity, rounded up to a power of two. The capacity of an
+  /// existing ring is kept.
+  explicit SharedMemoryRing(const char *name,
+                            size_t capacity = DefaultCapacity) noexcept;
+  ~SharedMemoryRing();
+
+  SharedMemoryRing(const SharedMemoryRing &) = delete;
+  SharedMemoryRing &operator=(const SharedMemoryRing &) = delete;
+
+  /// Appends a complete record. Returns false, if it has been dropped because
+  /// the ring is full.
+  bool write(std::string_view record) noexcept;
+
+  /// Reads up to max_records records and removes them from the ring. Only one
+  /// process may read from a ring at a time. Returns the number of records
+  /// read.
+  size_t read(ReadFn read_fn, void *context,
+              size_t max_records = SIZE_MAX) noexcept;
+
+  [[nodiscard]] uint64_t getNumDropped() const noexcept;
+  [[nodiscard]] size_t getCapacity() const noexcept;
+
+  [[nodiscard]] bool isValid() const noexcept;
+
+  /// Removes the shared memory object; mapped rings stay valid until they
+  /// are destroyed.
+  static bool remove(const char *name) noexcept;
+
+private:
+  struct Impl;
+  Impl *impl{};
+};
+
+/// Logs into a SharedMemoryRing. Multiple loggers, also in different
+/// processes, may share the same ring.
+class ITST_API SharedMemoryLogger : public LoggerImpl<SharedMemoryLogger> {
+public:
+  explicit SharedMemoryLogger(SharedMemoryRing &ring,
+                              std::string_view class_name,
+                              LogSeverity sev = DefaultSeverity) noexcept
+      : LoggerImpl(class_name, sev), ring(&ring) {}
+
+  void commitRecord(LogSeverity /*msg_sev*/) const noexcept {
+    ring->write(RecordBuffer::view());
+    RecordBuffer::reset();
+  }
+
+  /// The records are visible to the collector as soon as they are written
+  void flushRecords() const noexcept {}
+
+private:
+  SharedMemoryRing *ring{};
+};
+} // namespace itst
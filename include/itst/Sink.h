@@ -0,0 +1,148 @@
+#pragma once
+
+#include "itst/LockPolicy.h"
+#include "itst/LoggerBase.h"
+#include "itst/RecordBuffer.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+namespace itst {
+/// A slice of a batch of records, with the layout of POSIX' struct iovec
+struct iovec {
+  void *iov_base;
+  size_t iov_len;
+};
+} // namespace itst
+#else
+#include <sys/uio.h>
+#endif
+
+namespace itst {
+
+/// Lock policy of sinks that are not thread-safe by themselves: All calls to
+/// the sink are serialized with a mutex. See LockPolicy.h for the others.
+class MutexLock {
+public:
+  void lock() noexcept { mtx.lock(); }
+  void unlock() noexcept { mtx.unlock(); }
+
+private:
+  std::mutex mtx;
+};
+
+/// A destination of log records. Derived classes implement
+///
+///   void writeImpl(const iovec *slices, size_t num_slices) noexcept;
+///   void flushImpl() noexcept;
+///
+/// where writeImpl receives one or more complete records as consecutive
+/// slices, e.g., to pass them to writev without copying them first. The
+/// LockPolicy decides how the calls are synchronized.
+///
+/// Use SinkLogger to log into a sink. Its messages are staged in the calling
+/// thread's RecordBuffer, which is plain memory, and passed to write() as one
+/// slice each; they never pass through stdio.
+template <typename Derived, typename LockPolicy = MutexLock> class Sink {
+public:
+  /// Writes complete records, given as consecutive slices.
+  void write(const iovec *slices, size_t num_slices) noexcept {
+    std::lock_guard lck(lock_policy);
+    self().writeImpl(slices, num_slices);
+  }
+
+  void write(std::string_view record) noexcept {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    iovec slice{const_cast<char *>(record.data()), record.size()};
+    write(&slice, 1);
+  }
+
+  void flush() noexcept {
+    std::lock_guard lck(lock_policy);
+    self().flushImpl();
+  }
+
+protected:
+  Sink() noexcept = default;
+
+private:
+  [[nodiscard]] Derived &self() noexcept {
+    return static_cast<Derived &>(*this);
+  }
+
+  LockPolicy lock_policy;
+};
+
+/// Writes into a stdio stream. Thread-safe via the stream's own lock (see
+/// flockfile), such that the records do not interleave with other writers of
+/// the stream. The ConsoleLogger and the FileLoggers log through it.
+class ITST_API StdioSink : public Sink<StdioSink, NoLock> {
+  friend Sink;
+
+public:
+  explicit StdioSink(FILE *file_handle) noexcept : file_handle(file_handle) {}
+
+  /// Same as write(), but does not lock the stream, for streams that no other
+  /// thread writes to concurrently.
+  void writeUnlocked(std::string_view record) noexcept;
+
+  [[nodiscard]] FILE *getFileHandle() const noexcept { return file_handle; }
+
+private:
+  void writeImpl(const iovec *slices, size_t num_slices) noexcept;
+  void flushImpl() noexcept;
+
+  FILE *file_handle{};
+};
+
+/// Collects the records in memory. With the NoLock policy, only one thread
+/// may write at a time.
+template <typename LockPolicy = MutexLock>
+class BasicStringSink : public Sink<BasicStringSink<LockPolicy>, LockPolicy> {
+  friend class Sink<BasicStringSink, LockPolicy>;
+
+public:
+  /// The records written so far. Not synchronized with concurrent writes.
+  [[nodiscard]] std::string_view str() const noexcept { return buffer; }
+
+private:
+  void writeImpl(const iovec *slices, size_t num_slices) noexcept {
+    for (size_t i = 0; i != num_slices; ++i) {
+      buffer.append(static_cast<const char *>(slices[i].iov_base),
+                    slices[i].iov_len);
+    }
+  }
+  void flushImpl() noexcept {}
+
+  std::string buffer;
+};
+using StringSink = BasicStringSink<>;
+
+/// Logs into any Sink. Multiple loggers may share the same sink.
+template <typename SinkT>
+class SinkLogger : public LoggerImpl<SinkLogger<SinkT>> {
+public:
+  explicit SinkLogger(SinkT &sink, std::string_view class_name,
+                      LogSeverity sev = LoggerBase::DefaultSeverity) noexcept
+      : LoggerImpl<SinkLogger<SinkT>>(class_name, sev), sink(&sink) {}
+
+  void commitRecord(LogSeverity msg_sev) const noexcept {
+    sink->write(RecordBuffer::view());
+    RecordBuffer::reset();
+    if (this->shouldFlush(msg_sev)) {
+      sink->flush();
+    }
+  }
+
+  void flushRecords() const noexcept { sink->flush(); }
+
+  [[nodiscard]] SinkT &getSink() const noexcept { return *sink; }
+
+private:
+  SinkT *sink{};
+};
+} // namespace itst
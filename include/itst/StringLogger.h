@@ -1,24 +1,44 @@
 #pragma once
 
+#include "itst/Sink.h"
 #include "LoggerBase.h"
 
+#include <type_traits>
+
 namespace itst {
-class ITST_API StringLogger : public LoggerImpl<StringLogger> {
-  friend LoggerImpl;
+/// Collects the messages in a string. With the NoLock policy, the string is
+/// not guarded by a mutex, for loggers that only one thread uses.
+template <typename LockPolicy>
+class BasicStringLogger
+    : public LoggerImpl<BasicStringLogger<LockPolicy>, LockPolicy> {
+  friend class LoggerImpl<BasicStringLogger, LockPolicy>;
+
+  static_assert(std::is_same_v<LockPolicy, StreamLock> ||
+                    std::is_same_v<LockPolicy, NoLock>,
+                "The StringLogger takes the StreamLock or NoLock policy");
+
+  /// The lock of the string, see BasicStringSink
+  using SinkLock =
+      std::conditional_t<std::is_same_v<LockPolicy, NoLock>, NoLock, MutexLock>;
 
 public:
-  explicit StringLogger(std::string_view class_name,
-                        LogSeverity sev = DefaultSeverity) noexcept;
+  explicit BasicStringLogger(
+      std::string_view class_name,
+      LogSeverity sev = LoggerBase::DefaultSeverity) noexcept
+      : LoggerImpl<BasicStringLogger, LockPolicy>(class_name, sev) {}
 
-  ~StringLogger();
+  /// Everything that has been logged so far
+  [[nodiscard]] std::string_view str() const noexcept { return sink.str(); }
 
-  [[nodiscard]] std::string_view str() noexcept;
+  void commitRecord(LogSeverity /*msg_sev*/) const noexcept {
+    sink.write(RecordBuffer::view());
+    RecordBuffer::reset();
+  }
 
-private:
-  [[nodiscard]] FILE *getFileHandle() const noexcept { return file_handle; }
+  /// The records are in the string as soon as they are written
+  void flushRecords() const noexcept {}
 
-  FILE *file_handle{};
-  char *data{};
-  size_t size{};
+private:
+  mutable BasicStringSink<SinkLock> sink;
 };
 } // namespace itst
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "itst/Core.h"
+#include "itst/LoggerBase.h"
+#include "itst/RecordBuffer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+namespace itst {
+
+/// Writes spans and instant events in the Chrome trace-event JSON format,
+/// which can be loaded into Perfetto (ui.perfetto.dev) or chrome://tracing.
+///
+/// Events are recorded into per-thread buffers without taking a shared lock.
+/// A thread's buffer is written to the file when it is full, on flush() and
+/// periodically by the BackgroundFlusher. The timestamps are taken from
+/// std::chrono::steady_clock, i.e., CLOCK_MONOTONIC on Linux, so they can be
+/// correlated with `perf record -k CLOCK_MONOTONIC`.
+///
+/// The file is a JSON array of events. The closing bracket is written by the
+/// destructor, but the viewers also accept files without it, e.g., after a
+/// crash.
+class ITST_API TraceSink {
+public:
+  static constexpr size_t DefaultBufferSize = 4096;
+
+  /// buffer_size is the number of events that each thread buffers.
+  explicit TraceSink(const char *file_name,
+                     size_t buffer_size = DefaultBufferSize) noexcept;
+  ~TraceSink();
+
+  TraceSink(const TraceSink &) = delete;
+  TraceSink &operator=(const TraceSink &) = delete;
+
+  /// Begins a span on the calling thread. The name must be a string literal,
+  /// or otherwise outlive the sink.
+  void begin(const char *name) noexcept;
+  /// Ends the innermost span on the calling thread.
+  void end(const char *name) noexcept;
+  /// Records a complete span. The name must outlive the sink, see begin().
+  void complete(const char *name, std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end) noexcept;
+  /// Records an instant event, e.g., a log record.
+  void instant(std::string_view name, std::string_view category,
+               LogSeverity sev) noexcept;
+
+  /// Writes the events of all threads to the file.
+  void flush() noexcept;
+
+  /// Sets the sink that the ITST_TRACE_* macros record into. The sink must be
+  /// reset before it is destroyed.
+  static void setGlobal(TraceSink *sink) noexcept;
+  [[nodiscard]] static TraceSink *getGlobal() noexcept;
+
+private:
+  struct Impl;
+  Impl *impl{};
+};
+
+/// Records a span from construction to destruction.
+class ScopedSpan {
+public:
+  explicit ScopedSpan(const char *name,
+                      TraceSink *sink = TraceSink::getGlobal()) noexcept
+      : sink(sink), name(name) {
+    if (sink) {
+      start = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~ScopedSpan() {
+    if (sink) {
+      sink->complete(name, start, std::chrono::steady_clock::now());
+    }
+  }
+
+  ScopedSpan(const ScopedSpan &) = delete;
+  ScopedSpan &operator=(const ScopedSpan &) = delete;
+
+private:
+  TraceSink *sink{};
+  const char *name{};
+  std::chrono::steady_clock::time_point start{};
+};
+
+/// Logs each record as an instant event into a TraceSink, such that the log
+/// messages show up on the same timeline as the spans. The event's name is the
+/// message without the header.
+class ITST_API TraceLogger : public LoggerImpl<TraceLogger> {
+public:
+  explicit TraceLogger(TraceSink &sink, std::string_view class_name,
+                       LogSeverity sev = DefaultSeverity) noexcept
+      : LoggerImpl(class_name, sev), sink(&sink) {}
+
+  void commitRecord(LogSeverity msg_sev) const noexcept;
+
+  void flushRecords() const noexcept { sink->flush(); }
+
+private:
+  TraceSink *sink{};
+};
+
+namespace detail {
+inline void traceBegin(const char *name) noexcept {
+  if (auto *sink = TraceSink::getGlobal()) {
+    sink->begin(name);
+  }
+}
+inline void traceEnd(const char *name) noexcept {
+  if (auto *sink = TraceSink::getGlobal()) {
+    sink->end(name);
+  }
+}
+} // namespace detail
+} // namespace itst
+
+#ifndef ITST_DISABLE_LOGGER
+
+/// Begins/ends a span in the global TraceSink, see TraceSink::setGlobal()
+#define ITST_TRACE_BEGIN(NAME) ::itst::detail::traceBegin(NAME)
+#define ITST_TRACE_END(NAME) ::itst::detail::traceEnd(NAME)
+
+/// Records a span in the global TraceSink until the end of the enclosing scope
+#define ITST_TRACE_SCOPE(NAME)                                                 \
+  const ::itst::ScopedSpan ITST_CONCAT(itst_span_, __LINE__) { NAME }
+
+#else // ITST_DISABLE_LOGGER
+
+#define ITST_TRACE_BEGIN(NAME)                                                 \
+  do {                                                                         \
+  } while (false)
+#define ITST_TRACE_END(NAME)                                                   \
+  do {                                                                         \
+  } while (false)
+#define ITST_TRACE_SCOPE(NAME)                                                 \
+  do {                                                                         \
+  } while (false)
+
+#endif // ITST_DISABLE_LOGGER
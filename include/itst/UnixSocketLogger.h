@@ -0,0 +1,69 @@
+#pragma once
+
+#include "itst/LoggerBase.h"
+#include "itst/RecordBuffer.h"
+
+namespace itst {
+
+/// Sends complete records as datagrams over an AF_UNIX socket to a local
+/// collector, e.g., a syslog socket. Each datagram contains exactly one record
+/// including its header and the trailing line-feed.
+///
+/// Records are batched and sent with a single sendmmsg. The socket is
+/// non-blocking: if the collector falls behind, records are dropped instead of
+/// blocking the logging threads (see getNumDropped()). If the collector is not
+/// reachable, the sink retries to connect with the next batch.
+///
+/// Pending records are sent when the batch is full, on flush(), after a
+/// message that reaches the logger's flush-severity and periodically by the
+/// BackgroundFlusher.
+class ITST_API UnixSocketSink {
+public:
+  enum class SocketType {
+    Datagram,
+    SeqPacket,
+  };
+
+  static constexpr size_t DefaultBatchSize = 32;
+
+  explicit UnixSocketSink(const char *socket_path,
+                          SocketType type = SocketType::Datagram,
+                          size_t batch_size = DefaultBatchSize) noexcept;
+  ~UnixSocketSink();
+
+  UnixSocketSink(const UnixSocketSink &) = delete;
+  UnixSocketSink &operator=(const UnixSocketSink &) = delete;
+
+  /// Appends the record to the current batch. Sends the batch, if it is full
+  /// or if send_now is true.
+  void send(std::string_view record, bool send_now = false) noexcept;
+
+  /// Sends all pending records.
+  void flush() noexcept;
+
+  /// The number of records that have been dropped so far.
+  [[nodiscard]] size_t getNumDropped() const noexcept;
+
+private:
+  struct Impl;
+  Impl *impl{};
+};
+
+/// Logs into a UnixSocketSink. Multiple loggers may share the same sink.
+class ITST_API UnixSocketLogger : public LoggerImpl<UnixSocketLogger> {
+public:
+  explicit UnixSocketLogger(UnixSocketSink &sink, std::string_view class_name,
+                            LogSeverity sev = DefaultSeverity) noexcept
+      : LoggerImpl(class_name, sev), sink(&sink) {}
+
+  void commitRecord(LogSeverity msg_sev) const noexcept {
+    sink->send(RecordBuffer::view(), shouldFlush(msg_sev));
+    RecordBuffer::reset();
+  }
+
+  void flushRecords() const noexcept { sink->flush(); }
+
+private:
+  UnixSocketSink *sink{};
+};
+} // namespace itst
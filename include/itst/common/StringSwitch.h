@@ -12,14 +12,20 @@ constexpr bool
 // NOLINTNEXTLINE(readability-identifier-naming)
 any_of(std::string_view search_for,
        std::initializer_list<std::string_view> strings) noexcept {
-  return std::any_of(strings.begin(), strings.end(),
-                     [search_for](auto curr) { return search_for == curr; });
+  // Note: std::any_of is not constexpr before C++20
+  for (auto curr : strings) {
+    if (search_for == curr)
+      return true;
+  }
+  return false;
 }
 
 template <typename callable, typename returntype>
 static constexpr bool invocable_with_return =
     std::is_invocable_r_v<returntype, callable>;
 
+/// Compares the string against each case in turn, until one matches. For
+/// large sets of cases, see StringSwitchTable.
 template <typename T = void> class StringSwitch {
 public:
   inline constexpr explicit StringSwitch(
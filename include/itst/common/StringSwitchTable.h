@@ -0,0 +1,294 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace itst {
+
+namespace detail {
+/// FNV-1a
+constexpr uint64_t hashCase(std::string_view str) noexcept {
+  uint64_t hash = 0xcbf29ce484222325;
+  for (auto chr : str) {
+    hash ^= uint8_t(chr);
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+/// The buckets are selected by the high half of the hash, such that they are
+/// independent of the slots
+constexpr size_t bucketOfCase(uint64_t hash, size_t num_slots) noexcept {
+  return size_t(hash >> 32) & (num_slots - 1);
+}
+
+/// See the finalizer of MurmurHash3
+constexpr size_t slotOfCase(uint64_t hash, uint32_t seed,
+                            size_t num_slots) noexcept {
+  hash ^= seed * 0x9e3779b97f4a7c15;
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccd;
+  hash ^= hash >> 33;
+  return size_t(hash) & (num_slots - 1);
+}
+
+constexpr size_t nextPowerOf2(size_t num) noexcept {
+  size_t ret = 1;
+  while (ret < num) {
+    ret <<= 1;
+  }
+  return ret;
+}
+
+/// Not constexpr, such that building a table with one of these errors fails
+/// to compile and the compiler points here
+inline void duplicateStringSwitchCase() noexcept {}
+inline void noPerfectStringSwitchHash() noexcept {}
+} // namespace detail
+
+/// The result of looking up a string in a StringSwitchTable.
+template <typename T> class StringSwitchResult {
+public:
+  constexpr explicit StringSwitchResult(const T *match) noexcept
+      : match(match) {}
+
+  template <typename TT = T>
+  [[nodiscard]] constexpr std::enable_if_t<std::is_convertible_v<TT, T>, T>
+  // NOLINTNEXTLINE(readability-identifier-naming)
+  Default(TT &&ret) const noexcept(noexcept(T(std::forward<TT>(ret)))) {
+    if (match) {
+      return *match;
+    }
+    return std::forward<TT>(ret);
+  }
+
+  [[nodiscard]] constexpr std::optional<T>
+  // NOLINTNEXTLINE(readability-identifier-naming)
+  NoDefault() const noexcept {
+    if (match) {
+      return *match;
+    }
+    return std::nullopt;
+  }
+
+private:
+  const T *match{};
+};
+
+/// A string switch over a fixed set of cases that is built at compile time by
+/// StringSwitchBuilder.
+///
+/// The cases are laid out by a perfect hash (hash and displace), such that a
+/// lookup costs one hash over the string plus one comparison, independent of
+/// the number of cases. The string is hashed once; within a bucket of the
+/// first level, the cases are separated by re-mixing the hash with the
+/// bucket's seed.
+template <typename T, size_t N> class StringSwitchTable {
+  template <typename U, size_t M> friend class StringSwitchBuilder;
+
+public:
+  static constexpr size_t NumSlots = detail::nextPowerOf2(N);
+
+  /// The value of the case that matches str, or null
+  [[nodiscard]] constexpr const T *find(std::string_view str) const noexcept {
+    auto hash = detail::hashCase(str);
+    auto disp = displacements[detail::bucketOfCase(hash, NumSlots)];
+    auto slot = disp < 0 ? size_t(-(disp + 1))
+                         : detail::slotOfCase(hash, uint32_t(disp), NumSlots);
+    if (auto idx = slots[slot]; idx && keys[idx - 1] == str) {
+      return &values[idx - 1];
+    }
+    return nullptr;
+  }
+
+  /// Same as StringSwitch<T>(str), followed by the cases and by Default() or
+  /// NoDefault() on the result.
+  [[nodiscard]] constexpr StringSwitchResult<T>
+  operator()(std::string_view str) const noexcept {
+    return StringSwitchResult<T>(find(str));
+  }
+
+  [[nodiscard]] static constexpr size_t size() noexcept { return N; }
+
+private:
+  constexpr StringSwitchTable(const std::array<std::string_view, N> &keys,
+                              const std::array<T, N> &values) noexcept
+      : keys(keys), values(values) {
+    build();
+  }
+
+  constexpr void build() noexcept {
+    constexpr uint32_t MaxSeed = 1U << 16;
+
+    // Sort the cases into the buckets
+    std::array<uint64_t, N> hashes{};
+    std::array<size_t, NumSlots + 1> bucket_begin{};
+    for (size_t i = 0; i != N; ++i) {
+      hashes[i] = detail::hashCase(keys[i]);
+      ++bucket_begin[detail::bucketOfCase(hashes[i], NumSlots) + 1];
+    }
+    size_t max_bucket_size = 0;
+    for (size_t b = 0; b != NumSlots; ++b) {
+      if (bucket_begin[b + 1] > max_bucket_size) {
+        max_bucket_size = bucket_begin[b + 1];
+      }
+      bucket_begin[b + 1] += bucket_begin[b];
+    }
+    std::array<size_t, N> order{};
+    std::array<size_t, NumSlots> bucket_fill{};
+    for (size_t i = 0; i != N; ++i) {
+      auto bucket = detail::bucketOfCase(hashes[i], NumSlots);
+      order[bucket_begin[bucket] + bucket_fill[bucket]++] = i;
+    }
+
+    // Place the largest buckets first, while there is still much room
+    std::array<size_t, N> bucket_slots{};
+    size_t next_free_slot = 0;
+    for (size_t size = max_bucket_size; size != 0; --size) {
+      for (size_t b = 0; b != NumSlots; ++b) {
+        const auto begin = bucket_begin[b];
+        if (bucket_begin[b + 1] - begin != size) {
+          continue;
+        }
+
+        if (size == 1) {
+          while (slots[next_free_slot]) {
+            ++next_free_slot;
+          }
+          displacements[b] = -int32_t(next_free_slot) - 1;
+          slots[next_free_slot] = uint32_t(order[begin] + 1);
+          continue;
+        }
+
+        for (size_t i = 0; i != size; ++i) {
+          for (size_t j = 0; j != i; ++j) {
+            if (keys[order[begin + i]] == keys[order[begin + j]]) {
+              detail::duplicateStringSwitchCase();
+            }
+          }
+        }
+
+        uint32_t seed = 1;
+        for (; seed != MaxSeed; ++seed) {
+          bool fits = true;
+          for (size_t i = 0; i != size && fits; ++i) {
+            auto slot =
+                detail::slotOfCase(hashes[order[begin + i]], seed, NumSlots);
+            fits = !slots[slot];
+            for (size_t j = 0; j != i && fits; ++j) {
+              fits = bucket_slots[j] != slot;
+            }
+            bucket_slots[i] = slot;
+          }
+          if (fits) {
+            break;
+          }
+        }
+        if (seed == MaxSeed) {
+          detail::noPerfectStringSwitchHash();
+        }
+
+        displacements[b] = int32_t(seed);
+        for (size_t i = 0; i != size; ++i) {
+          slots[bucket_slots[i]] = uint32_t(order[begin + i] + 1);
+        }
+      }
+    }
+  }
+
+  std::array<std::string_view, N> keys{};
+  std::array<T, N> values{};
+  /// Per bucket: The seed of the bucket's slots, or -(slot + 1) for buckets
+  /// with a single case
+  std::array<int32_t, NumSlots> displacements{};
+  /// Per slot: The index of the case + 1, or 0 if empty
+  std::array<uint32_t, NumSlots> slots{};
+};
+
+namespace detail {
+/// The cases that one call of StringSwitchBuilder::Case() adds
+template <typename T> struct StringSwitchCases {
+  const StringSwitchCases *prev{};
+  /// Either one key (if num_keys is 0), or num_keys keys of an array
+  std::string_view key{};
+  const std::string_view *keys{};
+  size_t num_keys{};
+  T value{};
+};
+} // namespace detail
+
+/// Collects the cases of a StringSwitchTable at compile time, with the same
+/// fluent API as StringSwitch:
+///
+///   static constexpr auto Colors = StringSwitchBuilder<Color>()
+///                                      .Case("red", Color::Red)
+///                                      .Case({"green", "lime"}, Color::Green)
+///                                      .Build();
+///   auto color = Colors(str).Default(Color::Black);
+///
+/// Use this instead of StringSwitch for large sets of cases, as StringSwitch
+/// compares the string against every case. Unlike StringSwitch, the cases
+/// must be distinct (otherwise, Build() does not compile) and map to values;
+/// T must be default-constructible and usable in constant expressions.
+///
+/// Each Case() only links its cases to the ones before, so adding N cases
+/// costs O(N) at compile time. Hence, the builder is only valid until the end
+/// of the full expression, same as StringSwitch.
+template <typename T, size_t N = 0> class StringSwitchBuilder {
+  template <typename U, size_t M> friend class StringSwitchBuilder;
+
+public:
+  constexpr StringSwitchBuilder() noexcept = default;
+
+  StringSwitchBuilder(const StringSwitchBuilder &) = delete;
+  StringSwitchBuilder &operator=(const StringSwitchBuilder &) = delete;
+
+  [[nodiscard]] constexpr StringSwitchBuilder<T, N + 1>
+  // NOLINTNEXTLINE(readability-identifier-naming)
+  Case(std::string_view key, T value) && noexcept {
+    return {{&cases, key, nullptr, 0, value}};
+  }
+
+  template <size_t K>
+  [[nodiscard]] constexpr StringSwitchBuilder<T, N + K>
+  // NOLINTNEXTLINE(readability-identifier-naming)
+  Case(const std::string_view (&keys)[K], T value) && noexcept {
+    return {{&cases, {}, keys, K, value}};
+  }
+
+  /// Computes the perfect hash. Call this in a constexpr context, such that
+  /// it runs at compile time.
+  [[nodiscard]] constexpr StringSwitchTable<T, N>
+  // NOLINTNEXTLINE(readability-identifier-naming)
+  Build() && noexcept {
+    std::array<std::string_view, N> keys{};
+    std::array<T, N> values{};
+    size_t idx = N;
+    for (const auto *curr = &cases; idx != 0; curr = curr->prev) {
+      if (!curr->num_keys) {
+        keys[--idx] = curr->key;
+        values[idx] = curr->value;
+        continue;
+      }
+      for (size_t i = curr->num_keys; i != 0; --i) {
+        keys[--idx] = curr->keys[i - 1];
+        values[idx] = curr->value;
+      }
+    }
+    return {keys, values};
+  }
+
+private:
+  constexpr StringSwitchBuilder(detail::StringSwitchCases<T> cases) noexcept
+      : cases(cases) {}
+
+  /// The cases of the last call to Case()
+  detail::StringSwitchCases<T> cases{};
+};
+
+} // namespace itst
@@ -8,8 +8,8 @@
 #endif
 
 #include <concepts>
+#include <iosfwd>
 #include <optional>
-#include <ostream>
 #include <string>
 
 namespace itst {
@@ -41,6 +41,16 @@ template <typename... T> Overloaded(T...) -> Overloaded<T...>;
 template <typename T>
 static constexpr bool is_optional_v = detail::is_optional<T>::value;
 
+/// Whether a value of type R can be returned, e.g., by to_string() or str(),
+/// without allocating. Owning strings are not trivially destructible, so this
+/// accepts references, pointers, string_views and fixed-size buffers.
+template <typename R>
+static constexpr bool is_alloc_free_result_v =
+    std::is_reference_v<R> || std::is_trivially_destructible_v<R>;
+
+/// For static_asserts that must only fire when instantiated
+template <typename T> static constexpr bool dependent_false_v = false;
+
 /// Utility to check the typename of a template instantiation
 template <typename Str> static void tell(Str /*S*/) noexcept {
   puts(__PRETTY_FUNCTION__);
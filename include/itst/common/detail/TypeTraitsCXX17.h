@@ -64,4 +64,7 @@ static constexpr bool has_toString_v = detail::has_toString<T>::value;
 
 template <typename T>
 static constexpr bool is_iterable_v = detail::is_iterable<T>::value;
+
+/// std::formatter requires C++20
+template <typename T> static constexpr bool has_std_formatter_v = false;
 } // namespace itst
@@ -1,6 +1,13 @@
 #pragma once
 
-#include <ostream>
+#include <concepts>
+#include <iosfwd>
+#include <type_traits>
+#include <version>
+
+#ifdef __cpp_lib_format
+#include <format>
+#endif
 
 namespace itst {
 
@@ -26,6 +33,21 @@ template <typename T>
 concept has_toString_v = requires(const T &Val) {
   { Val.toString() } -> std::convertible_to<std::string_view>;
 };
+#ifdef __cpp_lib_format
+/// Types with an enabled std::formatter (disabled specializations are not
+/// default-constructible)
+template <typename T>
+concept has_std_formatter_v =
+    std::semiregular<std::formatter<std::remove_cvref_t<T>, char>> &&
+    requires(std::formatter<std::remove_cvref_t<T>, char> &Fmt, const T &Val,
+             std::format_context &Ctx) {
+  { Fmt.format(Val, Ctx) } -> std::same_as<std::format_context::iterator>;
+};
+#else
+template <typename T>
+concept has_std_formatter_v = false;
+#endif
+
 template <typename T>
 concept is_iterable_v = std::is_array_v<T> || requires(const T &Val) {
   {Val.begin()};
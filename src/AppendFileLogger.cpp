@@ -0,0 +1,148 @@
+#include "itst/AppendFileLogger.h"
+#include "itst/Buffering.h"
+#include "itst/Core.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <mutex>
+#include <string>
+
+namespace itst {
+namespace {
+void flushSink(void *context) noexcept {
+  static_cast<AppendFileSink *>(context)->flush();
+}
+
+/// Issues the slices with one writev. Only if the kernel writes less (e.g.,
+/// because the disk is full), the rest follows in further syscalls, i.e., the
+/// record is no longer appended atomically.
+void writeAll(int fd, const iovec *slices, size_t num_slices) noexcept {
+  // More slices than one writev takes are joined instead of being split
+  // across several syscalls. The loggers' records are a single slice, so
+  // this only allocates for direct writes into the sink.
+  std::string joined;
+  iovec joined_slice{};
+  if (num_slices > IOV_MAX) {
+    for (size_t i = 0; i != num_slices; ++i) {
+      joined.append(static_cast<const char *>(slices[i].iov_base),
+                    slices[i].iov_len);
+    }
+    joined_slice = {joined.data(), joined.size()};
+    slices = &joined_slice;
+    num_slices = 1;
+  }
+
+  while (num_slices) {
+    auto ret = ::writev(fd, slices, int(num_slices));
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("Failed to append record");
+      return;
+    }
+
+    auto written = size_t(ret);
+    while (num_slices && written >= slices->iov_len) {
+      written -= slices->iov_len;
+      ++slices;
+      --num_slices;
+    }
+    if (written) {
+      // Note: Only the rest of a partially written slice is left
+      auto rest = *slices;
+      rest.iov_base = static_cast<char *>(rest.iov_base) + written;
+      rest.iov_len -= written;
+      writeAll(fd, &rest, 1);
+      ++slices;
+      --num_slices;
+    }
+  }
+}
+} // namespace
+
+struct AppendFileSink::Impl {
+  int fd = -1;
+  size_t batch_size{};
+
+  /// Only used with a batch_size
+  std::mutex mtx;
+  std::string batch;
+
+  void writeBatch() noexcept {
+    if (!batch.empty()) {
+      iovec slice{batch.data(), batch.size()};
+      writeAll(fd, &slice, 1);
+      batch.clear();
+    }
+  }
+};
+
+AppendFileSink::AppendFileSink(const char *file_name,
+                               size_t batch_size) noexcept
+    : impl(new Impl()) {
+  impl->fd = open(file_name, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+#ifndef ITST_DISABLE_ASSERT
+  if (impl->fd < 0) {
+    perror("Failed to open file stream");
+    ITST_BUILTIN_TRAP;
+  }
+#endif // ITST_DISABLE_ASSERT
+
+  impl->batch_size = batch_size;
+  if (batch_size) {
+    impl->batch.reserve(batch_size);
+    BackgroundFlusher::add(&flushSink, this);
+  }
+}
+
+AppendFileSink::~AppendFileSink() {
+  if (impl->batch_size) {
+    BackgroundFlusher::remove(&flushSink, this);
+    impl->writeBatch();
+  }
+  if (impl->fd >= 0) {
+    close(impl->fd);
+  }
+  delete impl;
+}
+
+void AppendFileSink::writeImpl(const iovec *slices,
+                               size_t num_slices) noexcept {
+  if (impl->fd < 0) {
+    return;
+  }
+  if (!impl->batch_size) {
+    writeAll(impl->fd, slices, num_slices);
+    return;
+  }
+
+  size_t size = 0;
+  for (size_t i = 0; i != num_slices; ++i) {
+    size += slices[i].iov_len;
+  }
+
+  std::lock_guard lck(impl->mtx);
+  if (impl->batch.size() + size > impl->batch_size) {
+    impl->writeBatch();
+  }
+  if (size >= impl->batch_size) {
+    writeAll(impl->fd, slices, num_slices);
+    return;
+  }
+  for (size_t i = 0; i != num_slices; ++i) {
+    impl->batch.append(static_cast<const char *>(slices[i].iov_base),
+                       slices[i].iov_len);
+  }
+}
+
+void AppendFileSink::flushImpl() noexcept {
+  if (impl->batch_size) {
+    std::lock_guard lck(impl->mtx);
+    impl->writeBatch();
+  }
+}
+} // namespace itst
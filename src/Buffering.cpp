@@ -0,0 +1,213 @@
+#include "itst/Buffering.h"
+#include "itst/ConsoleLogger.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace itst {
+bool setStreamBuffering(FILE *file_handle, BufferMode mode, char *buffer,
+                        size_t buffer_size) noexcept {
+  static constexpr int Modes[] = {_IOFBF, _IOLBF, _IONBF};
+
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+  auto stdio_mode = Modes[static_cast<size_t>(mode)];
+  if (mode == BufferMode::Unbuffered) {
+    buffer = nullptr;
+    buffer_size = 0;
+  }
+
+#ifdef _GNU_SOURCE
+  flockfile(file_handle);
+  fflush_unlocked(file_handle);
+  bool success = setvbuf(file_handle, buffer, stdio_mode, buffer_size) == 0;
+  funlockfile(file_handle);
+  return success;
+#else
+  fflush(file_handle);
+  return setvbuf(file_handle, buffer, stdio_mode, buffer_size) == 0;
+#endif
+}
+
+namespace {
+using FlushFn = BackgroundFlusher::FlushFn;
+
+struct FlushEntry {
+  FlushFn flush{};
+  void *context{};
+  /// Set while a thread runs the callback outside of the lock
+  bool running = false;
+  bool removed = false;
+  /// The callback is skipped while paused, see BackgroundFlusher::pause()
+  size_t num_paused = 0;
+};
+
+struct FlusherState {
+  std::mutex mtx;
+  std::condition_variable cv;
+  /// Signaled whenever a callback has returned
+  std::condition_variable done_cv;
+  std::vector<std::shared_ptr<FlushEntry>> entries;
+  std::chrono::milliseconds interval{};
+  std::thread thread;
+  bool running = false;
+};
+
+void flushStream(void *context) noexcept {
+  auto *file_handle = static_cast<FILE *>(context);
+#ifdef _GNU_SOURCE
+  // Don't block, if a logger currently writes to the stream. It is flushed in
+  // the next round anyway
+  if (ftrylockfile(file_handle) != 0) {
+    return;
+  }
+  fflush_unlocked(file_handle);
+  funlockfile(file_handle);
+#else
+  fflush(file_handle);
+#endif
+}
+
+FlusherState &getState() noexcept {
+  // Intentionally leaked: Loggers may still unregister their streams during
+  // static destruction
+  static auto *state = [] {
+    auto *ret = new FlusherState();
+    ret->entries.push_back(std::make_shared<FlushEntry>(
+        FlushEntry{&flushStream, ITST_CONSOLE_LOGGER_TARGET}));
+    return ret;
+  }();
+  return *state;
+}
+
+/// Runs the callbacks without holding the lock, such that a slow sink neither
+/// delays the flushes of the others nor blocks add() and remove(). Each
+/// callback runs on at most one thread at a time.
+void runCallbacks(FlusherState &state,
+                  std::unique_lock<std::mutex> &lck) noexcept {
+  auto entries = state.entries;
+  for (const auto &entry : entries) {
+    state.done_cv.wait(lck, [&entry] { return !entry->running; });
+    if (entry->removed || entry->num_paused) {
+      continue;
+    }
+
+    entry->running = true;
+    lck.unlock();
+    entry->flush(entry->context);
+    lck.lock();
+    entry->running = false;
+    state.done_cv.notify_all();
+  }
+}
+
+auto findEntry(FlusherState &state, FlushFn flush, void *context) noexcept {
+  return std::find_if(state.entries.begin(), state.entries.end(),
+                      [flush, context](const auto &entry) {
+                        return entry->flush == flush &&
+                               entry->context == context;
+                      });
+}
+
+void runFlusher(FlusherState &state) noexcept {
+  std::unique_lock lck(state.mtx);
+  while (state.running) {
+    state.cv.wait_for(lck, state.interval);
+    runCallbacks(state, lck);
+  }
+}
+} // namespace
+
+void BackgroundFlusher::start(std::chrono::milliseconds interval) noexcept {
+  auto &state = getState();
+  std::lock_guard lck(state.mtx);
+  state.interval = std::max(interval, std::chrono::milliseconds(1));
+  if (state.running) {
+    state.cv.notify_one();
+    return;
+  }
+
+  state.running = true;
+  state.thread = std::thread(runFlusher, std::ref(state));
+}
+
+void BackgroundFlusher::stop() noexcept {
+  auto &state = getState();
+  std::thread thread;
+  {
+    std::lock_guard lck(state.mtx);
+    if (!state.running) {
+      return;
+    }
+    state.running = false;
+    thread = std::move(state.thread);
+  }
+
+  state.cv.notify_one();
+  thread.join();
+}
+
+void BackgroundFlusher::flushAll() noexcept {
+  auto &state = getState();
+  std::unique_lock lck(state.mtx);
+  runCallbacks(state, lck);
+}
+
+void BackgroundFlusher::add(FILE *file_handle) noexcept {
+  add(&flushStream, file_handle);
+}
+
+void BackgroundFlusher::remove(FILE *file_handle) noexcept {
+  remove(&flushStream, file_handle);
+}
+
+void BackgroundFlusher::pause(FILE *file_handle) noexcept {
+  auto &state = getState();
+  std::unique_lock lck(state.mtx);
+  auto it = findEntry(state, &flushStream, file_handle);
+  if (it == state.entries.end()) {
+    return;
+  }
+
+  auto entry = *it;
+  ++entry->num_paused;
+  // The caller writes into the stream without locking it afterwards
+  state.done_cv.wait(lck, [&entry] { return !entry->running; });
+}
+
+void BackgroundFlusher::resume(FILE *file_handle) noexcept {
+  auto &state = getState();
+  std::lock_guard lck(state.mtx);
+  if (auto it = findEntry(state, &flushStream, file_handle);
+      it != state.entries.end() && (*it)->num_paused) {
+    --(*it)->num_paused;
+  }
+}
+
+void BackgroundFlusher::add(FlushFn flush, void *context) noexcept {
+  auto &state = getState();
+  std::lock_guard lck(state.mtx);
+  state.entries.push_back(
+      std::make_shared<FlushEntry>(FlushEntry{flush, context}));
+}
+
+void BackgroundFlusher::remove(FlushFn flush, void *context) noexcept {
+  auto &state = getState();
+  std::unique_lock lck(state.mtx);
+  auto it = findEntry(state, flush, context);
+  if (it == state.entries.end()) {
+    return;
+  }
+
+  auto entry = *it;
+  state.entries.erase(it);
+  entry->removed = true;
+  // The caller may close the destination afterwards, so wait until a running
+  // flush has finished
+  state.done_cv.wait(lck, [&entry] { return !entry->running; });
+}
+} // namespace itst
@@ -0,0 +1,128 @@
+#include "itst/CallSiteRegistry.h"
+
+#include <mutex>
+#include <utility>
+
+namespace itst {
+namespace {
+struct Registry {
+  std::mutex mtx;
+  const CallSite *head{};
+  uint32_t num_sites = 0;
+  std::vector<std::pair<CallSiteFilter, CallSiteState>> filters;
+};
+
+Registry &getRegistry() noexcept {
+  // Intentionally leaked: Sites may still be reached during static
+  // destruction
+  static auto *reg = new Registry();
+  return *reg;
+}
+
+bool matchesGlob(std::string_view pattern, std::string_view str) noexcept {
+  // Iterative matching with backtracking to the last '*'
+  size_t pat_pos = 0;
+  size_t str_pos = 0;
+  size_t star_pos = std::string_view::npos;
+  size_t star_match = 0;
+
+  while (str_pos < str.size()) {
+    if (pat_pos < pattern.size() &&
+        (pattern[pat_pos] == '?' || pattern[pat_pos] == str[str_pos])) {
+      ++pat_pos;
+      ++str_pos;
+    } else if (pat_pos < pattern.size() && pattern[pat_pos] == '*') {
+      star_pos = pat_pos++;
+      star_match = str_pos;
+    } else if (star_pos != std::string_view::npos) {
+      pat_pos = star_pos + 1;
+      str_pos = ++star_match;
+    } else {
+      return false;
+    }
+  }
+
+  while (pat_pos < pattern.size() && pattern[pat_pos] == '*') {
+    ++pat_pos;
+  }
+  return pat_pos == pattern.size();
+}
+
+std::string_view getFileName(std::string_view path) noexcept {
+  auto slash = path.find_last_of("/\\");
+  return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+} // namespace
+
+bool CallSiteFilter::matches(const CallSite &site) const noexcept {
+  if (line && line != site.line) {
+    return false;
+  }
+  if (!matchesGlob(file, site.file) &&
+      !matchesGlob(file, getFileName(site.file))) {
+    return false;
+  }
+  return matchesGlob(function, site.function);
+}
+
+CallSiteState detail::registerCallSite(const CallSite &site) noexcept {
+  auto &reg = getRegistry();
+  std::lock_guard lck(reg.mtx);
+  // Another thread may have registered the site in the meantime
+  auto ret = site.state.load(std::memory_order_relaxed);
+  if (ret != CallSiteState::Unregistered) {
+    return ret;
+  }
+
+  ret = CallSiteState::Default;
+  for (const auto &[filter, state] : reg.filters) {
+    if (filter.matches(site)) {
+      ret = state;
+    }
+  }
+
+  site.id = reg.num_sites++;
+  site.next = std::exchange(reg.head, &site);
+  site.state.store(ret, std::memory_order_relaxed);
+  return ret;
+}
+
+size_t CallSiteRegistry::setState(const CallSiteFilter &filter,
+                                  CallSiteState state) {
+  if (state == CallSiteState::Unregistered) {
+    return 0;
+  }
+
+  auto &reg = getRegistry();
+  std::lock_guard lck(reg.mtx);
+  reg.filters.emplace_back(filter, state);
+
+  size_t num_matches = 0;
+  for (const auto *site = reg.head; site; site = site->next) {
+    if (filter.matches(*site)) {
+      site->state.store(state, std::memory_order_relaxed);
+      ++num_matches;
+    }
+  }
+  return num_matches;
+}
+
+void CallSiteRegistry::reset() noexcept {
+  auto &reg = getRegistry();
+  std::lock_guard lck(reg.mtx);
+  reg.filters.clear();
+  for (const auto *site = reg.head; site; site = site->next) {
+    site->state.store(CallSiteState::Default, std::memory_order_relaxed);
+  }
+}
+
+std::vector<const CallSite *> CallSiteRegistry::getCallSites() {
+  auto &reg = getRegistry();
+  std::lock_guard lck(reg.mtx);
+  std::vector<const CallSite *> ret;
+  for (const auto *site = reg.head; site; site = site->next) {
+    ret.push_back(site);
+  }
+  return ret;
+}
+} // namespace itst
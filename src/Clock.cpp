@@ -0,0 +1,267 @@
+#include "itst/Clock.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+#define ITST_HAS_TSC 1
+#endif
+
+namespace itst {
+namespace {
+constexpr int64_t NanosPerSec = 1'000'000'000;
+
+int64_t toNanos(const timespec &time) noexcept {
+  return int64_t(time.tv_sec) * NanosPerSec + time.tv_nsec;
+}
+
+timespec fromNanos(int64_t nanos) noexcept {
+  timespec ret{};
+  ret.tv_sec = time_t(nanos / NanosPerSec);
+  ret.tv_nsec = long(nanos % NanosPerSec);
+  return ret;
+}
+
+int64_t readClock(clockid_t clock) noexcept {
+  timespec time{};
+  clock_gettime(clock, &time);
+  return toNanos(time);
+}
+
+#ifdef __linux__
+constexpr clockid_t RealtimeCoarseClock = CLOCK_REALTIME_COARSE;
+constexpr clockid_t MonotonicCoarseClock = CLOCK_MONOTONIC_COARSE;
+#else
+constexpr clockid_t RealtimeCoarseClock = CLOCK_REALTIME;
+constexpr clockid_t MonotonicCoarseClock = CLOCK_MONOTONIC;
+#endif
+
+uint64_t readTsc() noexcept {
+#ifdef ITST_HAS_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+bool hasInvariantTsc() noexcept {
+#if defined(ITST_HAS_TSC) && !defined(_MSC_VER)
+  unsigned eax = 0;
+  unsigned ebx = 0;
+  unsigned ecx = 0;
+  unsigned edx = 0;
+  if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  return edx & (1U << 8);
+#elif defined(ITST_HAS_TSC)
+  std::array<int, 4> regs{};
+  __cpuid(regs.data(), 0x80000007);
+  return regs[3] & (1 << 8);
+#else
+  return false;
+#endif
+}
+
+/// Maps the ticks of a clock linearly to CLOCK_REALTIME.
+///
+/// Protected by a sequence lock, such that the logging threads can read it
+/// without taking a lock, while one of them recalibrates.
+struct Calibration {
+  std::atomic<uint64_t> seq{};
+  std::atomic<uint64_t> base_ticks{};
+  std::atomic<int64_t> base_nanos{};
+  std::atomic<double> nanos_per_tick{1.0};
+
+  /// The first calibration point, which gives the most accurate rate over a
+  /// long runtime
+  uint64_t first_ticks{};
+  int64_t first_nanos{};
+  std::mutex writer_mtx;
+
+  void store(uint64_t ticks, int64_t nanos, double rate) noexcept {
+    auto curr = seq.load(std::memory_order_relaxed);
+    seq.store(curr + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    base_ticks.store(ticks, std::memory_order_relaxed);
+    base_nanos.store(nanos, std::memory_order_relaxed);
+    nanos_per_tick.store(rate, std::memory_order_relaxed);
+    seq.store(curr + 2, std::memory_order_release);
+  }
+
+  int64_t convert(uint64_t ticks) const noexcept {
+    while (true) {
+      auto before = seq.load(std::memory_order_acquire);
+      auto curr_ticks = base_ticks.load(std::memory_order_relaxed);
+      auto curr_nanos = base_nanos.load(std::memory_order_relaxed);
+      auto rate = nanos_per_tick.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (!(before & 1) && before == seq.load(std::memory_order_relaxed)) {
+        // Note: Signed, because the ticks may be older than the base
+        auto delta = int64_t(ticks - curr_ticks);
+        return curr_nanos + int64_t(double(delta) * rate);
+      }
+    }
+  }
+
+  [[nodiscard]] uint64_t getBaseTicks() const noexcept {
+    return base_ticks.load(std::memory_order_relaxed);
+  }
+};
+
+struct ClockState {
+  std::atomic<ClockSource> source{ClockSource::Realtime};
+  std::atomic<int64_t> recalibration_interval_nanos{NanosPerSec};
+
+  Calibration tsc;
+  Calibration monotonic;
+  /// The recalibration interval converted to TSC ticks
+  std::atomic<uint64_t> tsc_recalibration_ticks{};
+};
+
+ClockState &getState() noexcept {
+  static ClockState state;
+  return state;
+}
+
+void calibrateTsc(ClockState &state) noexcept {
+  auto &cal = state.tsc;
+  std::lock_guard lck(cal.writer_mtx);
+  cal.first_ticks = readTsc();
+  cal.first_nanos = readClock(CLOCK_REALTIME);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  auto ticks = readTsc();
+  auto nanos = readClock(CLOCK_REALTIME);
+
+  auto rate = double(nanos - cal.first_nanos) / double(ticks - cal.first_ticks);
+  cal.store(ticks, nanos, rate);
+  state.tsc_recalibration_ticks.store(
+      uint64_t(double(state.recalibration_interval_nanos.load()) / rate),
+      std::memory_order_relaxed);
+}
+
+void calibrateMonotonic(ClockState &state) noexcept {
+  auto &cal = state.monotonic;
+  std::lock_guard lck(cal.writer_mtx);
+  auto ticks = uint64_t(readClock(MonotonicCoarseClock));
+  cal.store(ticks, readClock(RealtimeCoarseClock), 1.0);
+}
+
+/// Renews the base point, if the interval has elapsed. Called by the logging
+/// threads, so it never blocks: If another thread recalibrates already, the
+/// current calibration is used until it is done.
+void recalibrate(Calibration &cal, uint64_t ticks, uint64_t interval_ticks,
+                 bool tsc) noexcept {
+  // Note: Signed, because deferred timestamps may be older than the base
+  auto isDue = [&] {
+    return int64_t(ticks - cal.getBaseTicks()) >= int64_t(interval_ticks);
+  };
+  if (!isDue()) {
+    return;
+  }
+
+  std::unique_lock lck(cal.writer_mtx, std::try_to_lock);
+  if (!lck || !isDue()) {
+    return;
+  }
+
+  if (tsc) {
+    auto nanos = readClock(CLOCK_REALTIME);
+    ticks = readTsc();
+    // The rate over the whole runtime averages out the jitter of the
+    // individual clock_gettime calls
+    auto rate =
+        double(nanos - cal.first_nanos) / double(ticks - cal.first_ticks);
+    cal.store(ticks, nanos, rate);
+  } else {
+    cal.store(uint64_t(readClock(MonotonicCoarseClock)),
+              readClock(RealtimeCoarseClock), 1.0);
+  }
+}
+} // namespace
+
+bool Clock::isSupported(ClockSource source) noexcept {
+  if (source == ClockSource::Tsc) {
+    static const bool HasTsc = hasInvariantTsc();
+    return HasTsc;
+  }
+  return true;
+}
+
+bool Clock::setSource(ClockSource source) noexcept {
+  auto &state = getState();
+  if (!isSupported(source)) {
+    state.source.store(ClockSource::Realtime, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (source == ClockSource::Tsc) {
+    calibrateTsc(state);
+  } else if (source == ClockSource::MonotonicCoarse) {
+    calibrateMonotonic(state);
+  }
+  state.source.store(source, std::memory_order_release);
+  return true;
+}
+
+ClockSource Clock::getSource() noexcept {
+  return getState().source.load(std::memory_order_relaxed);
+}
+
+void Clock::setRecalibrationInterval(
+    std::chrono::milliseconds interval) noexcept {
+  auto &state = getState();
+  auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(interval)
+                   .count();
+  state.recalibration_interval_nanos.store(nanos, std::memory_order_relaxed);
+
+  auto rate = state.tsc.nanos_per_tick.load(std::memory_order_relaxed);
+  state.tsc_recalibration_ticks.store(uint64_t(double(nanos) / rate),
+                                      std::memory_order_relaxed);
+}
+
+Timestamp Clock::now() noexcept {
+  auto source = getState().source.load(std::memory_order_acquire);
+  switch (source) {
+  case ClockSource::Realtime:
+    return {uint64_t(readClock(CLOCK_REALTIME)), source};
+  case ClockSource::RealtimeCoarse:
+    return {uint64_t(readClock(RealtimeCoarseClock)), source};
+  case ClockSource::MonotonicCoarse:
+    return {uint64_t(readClock(MonotonicCoarseClock)), source};
+  case ClockSource::Tsc:
+    return {readTsc(), source};
+  }
+  ITST_BUILTIN_UNREACHABLE;
+}
+
+timespec Clock::toRealtime(Timestamp time) noexcept {
+  auto &state = getState();
+  switch (time.source) {
+  case ClockSource::Realtime:
+  case ClockSource::RealtimeCoarse:
+    return fromNanos(int64_t(time.ticks));
+  case ClockSource::MonotonicCoarse:
+    recalibrate(state.monotonic, time.ticks,
+                uint64_t(state.recalibration_interval_nanos.load(
+                    std::memory_order_relaxed)),
+                /*tsc=*/false);
+    return fromNanos(state.monotonic.convert(time.ticks));
+  case ClockSource::Tsc:
+    recalibrate(
+        state.tsc, time.ticks,
+        state.tsc_recalibration_ticks.load(std::memory_order_relaxed),
+        /*tsc=*/true);
+    return fromNanos(state.tsc.convert(time.ticks));
+  }
+  ITST_BUILTIN_UNREACHABLE;
+}
+} // namespace itst
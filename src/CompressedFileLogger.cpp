@@ -0,0 +1,298 @@
+#include "itst/CompressedFileLogger.h"
+#include "itst/Buffering.h"
+#include "itst/Core.h"
+
+#if defined(ITST_HAS_ZSTD)
+#include <zstd.h>
+#elif defined(ITST_HAS_LZ4)
+#include <lz4frame.h>
+#elif defined(ITST_HAS_ZLIB)
+#include <zlib.h>
+#else
+#error "The CompressedFileLogger requires zstd, lz4 or zlib"
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace itst {
+namespace {
+/// Only ever used by the background thread, once it has been created
+class Compressor {
+public:
+  explicit Compressor(int level) noexcept : level(level) {
+#if defined(ITST_HAS_ZSTD)
+    ctx = ZSTD_createCCtx();
+    valid = ctx != nullptr;
+    if (!level) {
+      this->level = ZSTD_CLEVEL_DEFAULT;
+    }
+#elif defined(ITST_HAS_ZLIB)
+    // Note: 15 + 16 window-bits produce gzip members instead of raw zlib
+    // streams
+    valid = deflateInit2(&stream, level ? level : Z_DEFAULT_COMPRESSION,
+                         Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+#endif
+  }
+
+  ~Compressor() {
+#if defined(ITST_HAS_ZSTD)
+    ZSTD_freeCCtx(ctx);
+#elif defined(ITST_HAS_ZLIB)
+    if (valid) {
+      deflateEnd(&stream);
+    }
+#endif
+  }
+
+  Compressor(const Compressor &) = delete;
+  Compressor &operator=(const Compressor &) = delete;
+
+  /// Whether the codec's context could be created
+  [[nodiscard]] bool isValid() const noexcept { return valid; }
+
+  /// Compresses the block into one self-contained frame. Returns an empty
+  /// frame on failure, also if the compressor is not valid.
+  [[nodiscard]] std::string_view compress(std::string_view block) noexcept {
+    if (!valid) {
+      return {};
+    }
+#if defined(ITST_HAS_ZSTD)
+    frame.resize(ZSTD_compressBound(block.size()));
+    auto len = ZSTD_compressCCtx(ctx, frame.data(), frame.size(), block.data(),
+                                 block.size(), level);
+    if (ZSTD_isError(len)) {
+      return {};
+    }
+    return {frame.data(), len};
+#elif defined(ITST_HAS_LZ4)
+    LZ4F_preferences_t prefs{};
+    prefs.compressionLevel = level;
+    prefs.frameInfo.contentSize = block.size();
+    frame.resize(LZ4F_compressFrameBound(block.size(), &prefs));
+    auto len = LZ4F_compressFrame(frame.data(), frame.size(), block.data(),
+                                  block.size(), &prefs);
+    if (LZ4F_isError(len)) {
+      return {};
+    }
+    return {frame.data(), len};
+#elif defined(ITST_HAS_ZLIB)
+    // Starts a new gzip member
+    deflateReset(&stream);
+    frame.resize(deflateBound(&stream, block.size()));
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    stream.next_in =
+        reinterpret_cast<Bytef *>(const_cast<char *>(block.data()));
+    stream.avail_in = uInt(block.size());
+    stream.next_out = reinterpret_cast<Bytef *>(frame.data());
+    stream.avail_out = uInt(frame.size());
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+      return {};
+    }
+    return {frame.data(), size_t(stream.total_out)};
+#endif
+  }
+
+private:
+  int level{};
+  bool valid = true;
+  std::string frame;
+#if defined(ITST_HAS_ZSTD)
+  ZSTD_CCtx *ctx{};
+#elif defined(ITST_HAS_ZLIB)
+  z_stream stream{};
+#endif
+};
+
+/// The number of full blocks that may wait for compression, before the
+/// logging threads have to wait
+constexpr size_t MaxPendingBlocks = 4;
+
+void flushSink(void *context) noexcept {
+  static_cast<CompressedFileSink *>(context)->flush();
+}
+
+void writeAll(int fd, std::string_view data) noexcept {
+  while (!data.empty()) {
+    auto ret = ::write(fd, data.data(), data.size());
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("Failed to write compressed block");
+      return;
+    }
+    data.remove_prefix(size_t(ret));
+  }
+}
+} // namespace
+
+struct CompressedFileSink::Impl {
+  std::mutex mtx;
+  std::condition_variable work_cv;
+  std::condition_variable done_cv;
+
+  int fd = -1;
+  size_t block_size{};
+
+  std::string block;
+  std::deque<std::string> pending;
+  /// Blocks that have been written already, to reuse their memory
+  std::vector<std::string> free_blocks;
+
+  size_t num_submitted = 0;
+  size_t num_written = 0;
+  bool stopping = false;
+
+  std::atomic<size_t> num_dropped_blocks{};
+
+  /// Created by the constructor, to report a failure to the caller
+  std::optional<Compressor> compressor;
+  std::thread thread;
+
+  void submit(std::unique_lock<std::mutex> &lck) noexcept;
+  void run() noexcept;
+};
+
+void CompressedFileSink::Impl::submit(
+    std::unique_lock<std::mutex> &lck) noexcept {
+  if (block.empty()) {
+    return;
+  }
+
+  done_cv.wait(lck, [this] { return pending.size() < MaxPendingBlocks; });
+  // Another thread may have submitted the block while this one waited
+  if (block.empty()) {
+    return;
+  }
+
+  pending.push_back(std::move(block));
+  ++num_submitted;
+  if (!free_blocks.empty()) {
+    block = std::move(free_blocks.back());
+    free_blocks.pop_back();
+  } else {
+    block = {};
+    block.reserve(block_size);
+  }
+
+  work_cv.notify_one();
+}
+
+void CompressedFileSink::Impl::run() noexcept {
+  std::unique_lock lck(mtx);
+  while (true) {
+    work_cv.wait(lck, [this] { return stopping || !pending.empty(); });
+    if (pending.empty()) {
+      return;
+    }
+
+    auto current = std::move(pending.front());
+    pending.pop_front();
+
+    lck.unlock();
+    // Note: Raw text would corrupt the compressed stream, so a block that
+    // fails to compress is dropped
+    if (auto frame = compressor->compress(current); !frame.empty()) {
+      writeAll(fd, frame);
+    } else {
+      num_dropped_blocks.fetch_add(1, std::memory_order_relaxed);
+      fputs("Failed to compress block; dropping it\n", stderr);
+    }
+    current.clear();
+    lck.lock();
+
+    free_blocks.push_back(std::move(current));
+    ++num_written;
+    done_cv.notify_all();
+  }
+}
+
+CompressedFileSink::CompressedFileSink(const char *file_name,
+                                       size_t block_size, int level) noexcept
+    : impl(new Impl()) {
+  impl->fd = open(file_name, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+#ifndef ITST_DISABLE_ASSERT
+  if (impl->fd < 0) {
+    perror("Failed to open file stream");
+    ITST_BUILTIN_TRAP;
+  }
+#endif // ITST_DISABLE_ASSERT
+
+  impl->block_size = block_size ? block_size : DefaultBlockSize;
+  impl->block.reserve(impl->block_size);
+
+  // Note: Without the assertions, an invalid compressor drops all blocks
+  impl->compressor.emplace(level);
+#ifndef ITST_DISABLE_ASSERT
+  if (!impl->compressor->isValid()) {
+    perror("Failed to create the compression context");
+    ITST_BUILTIN_TRAP;
+  }
+#endif // ITST_DISABLE_ASSERT
+  impl->thread = std::thread([impl = impl] { impl->run(); });
+
+  BackgroundFlusher::add(&flushSink, this);
+}
+
+CompressedFileSink::~CompressedFileSink() {
+  BackgroundFlusher::remove(&flushSink, this);
+  {
+    std::unique_lock lck(impl->mtx);
+    impl->submit(lck);
+    impl->stopping = true;
+  }
+  impl->work_cv.notify_one();
+  impl->thread.join();
+
+  if (impl->fd >= 0) {
+    close(impl->fd);
+  }
+  delete impl;
+}
+
+void CompressedFileSink::write(std::string_view record, bool flush) noexcept {
+  std::unique_lock lck(impl->mtx);
+  impl->block.append(record);
+
+  if (flush) {
+    impl->submit(lck);
+    auto target = impl->num_submitted;
+    impl->done_cv.wait(lck, [&] { return impl->num_written >= target; });
+  } else if (impl->block.size() >= impl->block_size) {
+    impl->submit(lck);
+  }
+}
+
+void CompressedFileSink::flush() noexcept {
+  std::unique_lock lck(impl->mtx);
+  impl->submit(lck);
+  auto target = impl->num_submitted;
+  impl->done_cv.wait(lck, [&] { return impl->num_written >= target; });
+}
+
+size_t CompressedFileSink::getNumDroppedBlocks() const noexcept {
+  return impl->num_dropped_blocks.load(std::memory_order_relaxed);
+}
+
+std::string_view CompressedFileSink::getCodecName() noexcept {
+#if defined(ITST_HAS_ZSTD)
+  return "zstd";
+#elif defined(ITST_HAS_LZ4)
+  return "lz4";
+#else
+  return "gzip";
+#endif
+}
+} // namespace itst
@@ -0,0 +1,53 @@
+#include "itst/ConsoleLogger.h"
+#include "itst/Buffering.h"
+#include "itst/RecordBuffer.h"
+#include "itst/Sink.h"
+
+#include <new>
+
+namespace itst {
+bool ConsoleLogger::setBuffering(BufferMode mode, size_t buffer_size) noexcept {
+  char *buffer = nullptr;
+  if (mode != BufferMode::Unbuffered && buffer_size) {
+    // Intentionally leaked: The console target is still written to and
+    // flushed after all static destructors have run
+    buffer = new (std::nothrow) char[buffer_size];
+    if (!buffer) {
+      return false;
+    }
+  }
+
+  return setStreamBuffering(ITST_CONSOLE_LOGGER_TARGET, mode, buffer,
+                            buffer_size);
+}
+
+StdioSink &ConsoleLogger::getSink() noexcept {
+  // Intentionally leaked, same as the buffer above
+  static auto *sink = new StdioSink(ITST_CONSOLE_LOGGER_TARGET);
+  return *sink;
+}
+
+void ConsoleLogger::commit(bool lock_stream, bool flush) noexcept {
+  auto &sink = getSink();
+  if (lock_stream) {
+    sink.write(RecordBuffer::view());
+  } else {
+    sink.writeUnlocked(RecordBuffer::view());
+  }
+  RecordBuffer::reset();
+
+  if (flush) {
+    sink.flush();
+  }
+}
+
+void ConsoleLogger::flushSink() noexcept { getSink().flush(); }
+
+void ConsoleLogger::lockingChanged(bool lock_stream) noexcept {
+  if (lock_stream) {
+    BackgroundFlusher::resume(ITST_CONSOLE_LOGGER_TARGET);
+  } else {
+    BackgroundFlusher::pause(ITST_CONSOLE_LOGGER_TARGET);
+  }
+}
+} // namespace itst
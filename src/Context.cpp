@@ -0,0 +1,121 @@
+#include "itst/Context.h"
+#include "itst/CallSiteRegistry.h"
+#include "itst/RecordBuffer.h"
+
+#include <array>
+#include <charconv>
+#include <ctime>
+#include <functional>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace itst {
+namespace {
+/// The capacity that is reserved for the context of each thread, see
+/// preallocateThreadBuffers()
+constexpr size_t ContextCapacity = 256;
+
+struct ThreadState {
+  std::string context;
+  /// Rendered lazily on first use and cached afterwards
+  std::string thread_field;
+
+#ifdef ITST_NO_ALLOC
+  ThreadState() { context.reserve(ContextCapacity); }
+#endif
+};
+
+// Note: The state is reached through a trivially destructible pointer, such
+// that messages that are logged by the destructors of other thread_local
+// objects after the state's destruction print neither context nor thread
+// field, instead of accessing the destroyed strings
+thread_local ThreadState *current_state = nullptr;
+thread_local bool state_destroyed = false;
+
+struct StateOwner {
+  ThreadState state;
+
+  StateOwner() noexcept { current_state = &state; }
+  ~StateOwner() {
+    current_state = nullptr;
+    state_destroyed = true;
+  }
+
+  StateOwner(const StateOwner &) = delete;
+  StateOwner(StateOwner &&) = delete;
+  StateOwner &operator=(const StateOwner &) = delete;
+  StateOwner &operator=(StateOwner &&) = delete;
+};
+
+/// nullptr once the calling thread's state is destroyed
+ThreadState *getThreadState() noexcept {
+  if (current_state || state_destroyed) {
+    return current_state;
+  }
+  static thread_local StateOwner owner;
+  return current_state;
+}
+
+std::string renderThreadId() {
+  auto tid = detail::getThreadId();
+  std::array<char, sizeof("[18446744073709551615]")> buf{};
+  buf[0] = '[';
+  auto [ptr, err] = std::to_chars(buf.data() + 1, buf.data() + buf.size(), tid);
+  *ptr++ = ']'; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  return {buf.data(), size_t(ptr - buf.data())};
+}
+} // namespace
+
+uint64_t detail::getThreadId() noexcept {
+#ifdef __linux__
+  static thread_local auto tid = static_cast<uint64_t>(syscall(SYS_gettid));
+#else
+  static thread_local auto tid =
+      uint64_t(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+#endif
+  return tid;
+}
+
+std::string *detail::getContextBuffer() noexcept {
+  auto *state = getThreadState();
+  return state ? &state->context : nullptr;
+}
+
+std::string_view detail::getThreadField() noexcept {
+  auto *state = getThreadState();
+  if (!state) {
+    return {};
+  }
+  if (state->thread_field.empty()) {
+    state->thread_field = renderThreadId();
+  }
+  return state->thread_field;
+}
+
+void preallocateThreadBuffers() noexcept {
+  if (auto *state = getThreadState();
+      state && state->context.capacity() < ContextCapacity) {
+    state->context.reserve(ContextCapacity);
+  }
+  (void)detail::getThreadField();
+  RecordBuffer::preallocate();
+  // Creates the registry, into which the call-sites link themselves
+  (void)CallSiteRegistry::getCallSites();
+  // Loads the timezone, which localtime_r does on its first call otherwise
+  tzset();
+}
+
+void setThreadName(std::string_view name) {
+  auto *state = getThreadState();
+  if (!state) {
+    return;
+  }
+  state->thread_field.assign(1, '[');
+  state->thread_field += name;
+  state->thread_field += ']';
+}
+} // namespace itst
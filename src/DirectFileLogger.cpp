@@ -0,0 +1,275 @@
+#include "itst/DirectFileLogger.h"
+#include "itst/Buffering.h"
+#include "itst/Core.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace itst {
+namespace {
+constexpr size_t Alignment = DirectFileSink::Alignment;
+
+constexpr uint64_t alignDown(uint64_t value) noexcept {
+  return value & ~uint64_t(Alignment - 1);
+}
+constexpr uint64_t alignUp(uint64_t value) noexcept {
+  return alignDown(value + Alignment - 1);
+}
+
+void flushSink(void *context) noexcept {
+  static_cast<DirectFileSink *>(context)->flush();
+}
+
+/// Writes an aligned range of the file. With O_DIRECT, the buffer, the offset
+/// and the length must all be aligned.
+void writeAllAt(int fd, const char *data, size_t len, uint64_t offset,
+                bool direct) noexcept {
+  auto begin = offset;
+  while (len) {
+    auto ret = ::pwrite(fd, data, len, off_t(offset));
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("Failed to write block");
+      return;
+    }
+    data += ret;
+    len -= size_t(ret);
+    offset += uint64_t(ret);
+  }
+
+  if (!direct) {
+    // Emulate O_DIRECT as far as possible: Get the written pages out of the
+    // page cache. Note: Dirty pages are not dropped, so write them first
+    sync_file_range(fd, off_t(begin), off_t(offset - begin),
+                    SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                        SYNC_FILE_RANGE_WAIT_AFTER);
+    posix_fadvise(fd, off_t(begin), off_t(offset - begin),
+                  POSIX_FADV_DONTNEED);
+  }
+}
+
+struct Block {
+  char *data{};
+  /// The file offset of the block; always aligned
+  uint64_t offset{};
+  /// The number of bytes of records in the block
+  size_t used{};
+  /// The number of bytes that flush() has already written to the file
+  size_t written{};
+};
+} // namespace
+
+struct DirectFileSink::Impl {
+  /// Serializes the logging threads, such that each record ends up in the
+  /// file contiguously, even if it spans two blocks
+  std::mutex write_mtx;
+  /// Protects the hand-off of the pending block to the background thread
+  std::mutex mtx;
+  std::condition_variable work_cv;
+  std::condition_variable done_cv;
+
+  int fd = -1;
+  bool direct = false;
+  size_t block_size{};
+
+  /// The block that the logging threads append to; guarded by write_mtx
+  Block current;
+  /// The full block that the background thread writes, if has_pending
+  Block pending;
+  bool has_pending = false;
+  bool stopping = false;
+
+  std::thread thread;
+
+  bool open(const char *file_name) noexcept;
+
+  /// Hands the full current block to the background thread and continues
+  /// with the other one. Waits, if the background thread is still busy.
+  void submit() noexcept;
+
+  /// Writes the not yet written part of the current block, padded to the
+  /// alignment, and cuts the padding off the file again.
+  void writeTail() noexcept;
+
+  void run() noexcept;
+};
+
+bool DirectFileSink::Impl::open(const char *file_name) noexcept {
+  // Note: No O_APPEND, as we write the partial last block again and again
+  fd = ::open(file_name, O_RDWR | O_CREAT | O_CLOEXEC | O_DIRECT, 0666);
+  direct = fd >= 0;
+  if (fd < 0 && errno == EINVAL) {
+    // The file system does not support O_DIRECT
+    fd = ::open(file_name, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+  }
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat info {};
+  if (fstat(fd, &info) != 0) {
+    return false;
+  }
+
+  // Continue in the block that contains the end of the file. As O_DIRECT
+  // only reads and writes whole aligned blocks, read its beginning first.
+  auto size = uint64_t(info.st_size);
+  current.offset = alignDown(size);
+  current.used = size_t(size - current.offset);
+  if (current.used) {
+    auto ret = pread(fd, current.data, Alignment, off_t(current.offset));
+    if (ret < ssize_t(current.used)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void DirectFileSink::Impl::submit() noexcept {
+  std::unique_lock lck(mtx);
+  done_cv.wait(lck, [this] { return !has_pending; });
+
+  auto next_offset = current.offset + block_size;
+  std::swap(current, pending);
+  has_pending = true;
+
+  current.offset = next_offset;
+  current.used = 0;
+  current.written = 0;
+
+  work_cv.notify_one();
+}
+
+void DirectFileSink::Impl::writeTail() noexcept {
+  {
+    // The file is truncated only after the previous block has been written;
+    // otherwise, the background thread might extend it again
+    std::unique_lock lck(mtx);
+    done_cv.wait(lck, [this] { return !has_pending; });
+  }
+  if (current.used == current.written) {
+    return;
+  }
+
+  auto begin = alignDown(current.written);
+  auto end = alignUp(current.used);
+  memset(current.data + current.used, 0, end - current.used);
+
+  writeAllAt(fd, current.data + begin, end - begin, current.offset + begin,
+             direct);
+  if (ftruncate(fd, off_t(current.offset + current.used)) != 0) {
+    perror("Failed to truncate the padding");
+  }
+  current.written = current.used;
+}
+
+void DirectFileSink::Impl::run() noexcept {
+  std::unique_lock lck(mtx);
+  while (true) {
+    work_cv.wait(lck, [this] { return stopping || has_pending; });
+    if (!has_pending) {
+      return;
+    }
+
+    // Note: The logging threads do not touch the pending block
+    lck.unlock();
+    writeAllAt(fd, pending.data + alignDown(pending.written),
+               block_size - alignDown(pending.written),
+               pending.offset + alignDown(pending.written), direct);
+    lck.lock();
+
+    has_pending = false;
+    done_cv.notify_all();
+  }
+}
+
+DirectFileSink::DirectFileSink(const char *file_name,
+                               size_t block_size) noexcept
+    : impl(new Impl()) {
+  impl->block_size = alignUp(block_size ? block_size : DefaultBlockSize);
+
+  void *mem = nullptr;
+  if (posix_memalign(&mem, Alignment, impl->block_size) == 0) {
+    impl->current.data = static_cast<char *>(mem);
+  }
+  if (posix_memalign(&mem, Alignment, impl->block_size) == 0) {
+    impl->pending.data = static_cast<char *>(mem);
+  }
+
+  if (!impl->current.data || !impl->pending.data ||
+      !impl->open(file_name)) {
+#ifndef ITST_DISABLE_ASSERT
+    perror("Failed to open file stream");
+    ITST_BUILTIN_TRAP;
+#endif // ITST_DISABLE_ASSERT
+    if (impl->fd >= 0) {
+      close(impl->fd);
+      impl->fd = -1;
+    }
+  }
+
+  impl->thread = std::thread([impl = impl] { impl->run(); });
+
+  BackgroundFlusher::add(&flushSink, this);
+}
+
+DirectFileSink::~DirectFileSink() {
+  BackgroundFlusher::remove(&flushSink, this);
+  if (impl->fd >= 0) {
+    std::lock_guard lck(impl->write_mtx);
+    impl->writeTail();
+  }
+  {
+    std::lock_guard lck(impl->mtx);
+    impl->stopping = true;
+  }
+  impl->work_cv.notify_one();
+  impl->thread.join();
+
+  if (impl->fd >= 0) {
+    close(impl->fd);
+  }
+  free(impl->current.data);
+  free(impl->pending.data);
+  delete impl;
+}
+
+void DirectFileSink::write(std::string_view record) noexcept {
+  std::lock_guard lck(impl->write_mtx);
+  if (impl->fd < 0) {
+    return;
+  }
+
+  auto &current = impl->current;
+  while (!record.empty()) {
+    auto len = std::min(record.size(), impl->block_size - current.used);
+    memcpy(current.data + current.used, record.data(), len);
+    current.used += len;
+    record.remove_prefix(len);
+
+    if (current.used == impl->block_size) {
+      impl->submit();
+    }
+  }
+}
+
+void DirectFileSink::flush() noexcept {
+  std::lock_guard lck(impl->write_mtx);
+  if (impl->fd >= 0) {
+    impl->writeTail();
+  }
+}
+
+bool DirectFileSink::isDirect() const noexcept { return impl->direct; }
+} // namespace itst
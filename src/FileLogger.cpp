@@ -1,5 +1,6 @@
 #include "itst/FileLogger.h"
 #include "itst/Core.h"
+#include "itst/FileRegistry.h"
 #include "itst/LoggerBase.h"
 
 #include <cstdio>
@@ -7,9 +8,11 @@
 namespace itst {
 FileLogger::FileLogger(const char *file_name, std::string_view class_name,
                        LogSeverity sev) noexcept
-    : LoggerImpl(class_name, sev), file_handle(fopen(file_name, "a+")) {
+    : LoggerImpl(class_name, sev),
+      shared_file(FileRegistry::acquire(file_name)),
+      sink(FileRegistry::getSink(shared_file)) {
 #ifndef ITST_DISABLE_ASSERT
-  if (!file_handle) {
+  if (!sink) {
     perror("Failed to open file stream");
     ITST_BUILTIN_TRAP;
   }
@@ -17,8 +20,23 @@ FileLogger::FileLogger(const char *file_name, std::string_view class_name,
 }
 
 FileLogger::~FileLogger() {
-  if (file_handle) {
-    fclose(file_handle);
+  if (!shouldLockStream()) {
+    lockingChanged(/*lock_stream=*/true);
   }
+  FileRegistry::release(shared_file);
 }
-} // namespace itst
\ No newline at end of file
+
+void FileLogger::lockingChanged(bool lock_stream) const noexcept {
+  if (auto *file_handle = FileRegistry::getFileHandle(shared_file)) {
+    if (lock_stream) {
+      BackgroundFlusher::resume(file_handle);
+    } else {
+      BackgroundFlusher::pause(file_handle);
+    }
+  }
+}
+
+bool FileLogger::setBuffering(BufferMode mode, size_t buffer_size) noexcept {
+  return FileRegistry::setBuffering(shared_file, mode, buffer_size);
+}
+} // namespace itst
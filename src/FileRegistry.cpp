@@ -0,0 +1,210 @@
+#include "itst/FileRegistry.h"
+#include "itst/Sink.h"
+
+#ifdef _MSC_VER
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace itst {
+struct SharedFile {
+  FILE *file_handle{};
+  StdioSink sink{nullptr};
+  size_t ref_count{};
+  std::string canonical_path;
+  std::unique_ptr<char[]> buffer;
+
+  /// Group commit of sync(): Each waiting thread takes a ticket; a sync
+  /// covers all tickets that have been taken before it started.
+  std::mutex sync_mtx;
+  std::condition_variable sync_cv;
+  uint64_t num_requested = 0;
+  uint64_t num_synced = 0;
+  bool syncing = false;
+};
+
+namespace {
+struct Registry {
+  std::mutex mtx;
+  std::unordered_map<std::string, std::unique_ptr<SharedFile>> files;
+};
+
+Registry &getRegistry() noexcept {
+  // Function-local static, such that global FileLoggers can safely acquire
+  // their files during static initialization
+  static Registry reg;
+  return reg;
+}
+
+std::string resolvePath(const char *path) {
+#ifdef _MSC_VER
+  char *resolved = _fullpath(nullptr, path, 0);
+#else
+  char *resolved = realpath(path, nullptr);
+#endif
+  if (!resolved) {
+    return {};
+  }
+  std::string ret(resolved);
+  free(resolved); // NOLINT(cppcoreguidelines-no-malloc)
+  return ret;
+}
+
+std::string canonicalPath(const char *file_name) {
+  if (auto ret = resolvePath(file_name); !ret.empty()) {
+    return ret;
+  }
+
+  // The file does not exist yet, so resolve its parent directory instead
+  std::string_view name(file_name);
+  auto slash = name.rfind('/');
+  std::string dir = slash == std::string_view::npos
+                        ? std::string(".")
+                        : std::string(name.substr(0, slash ? slash : 1));
+
+  auto ret = resolvePath(dir.c_str());
+  if (ret.empty()) {
+    return std::string(name);
+  }
+
+  if (ret.back() != '/') {
+    ret += '/';
+  }
+  ret += name.substr(slash == std::string_view::npos ? 0 : slash + 1);
+  return ret;
+}
+
+void syncFile(FILE *file_handle) noexcept {
+  fflush(file_handle);
+#ifdef _MSC_VER
+  _commit(_fileno(file_handle));
+#else
+  if (fdatasync(fileno(file_handle)) != 0) {
+    perror("Failed to sync file");
+  }
+#endif
+}
+} // namespace
+
+SharedFile *FileRegistry::acquire(const char *file_name) noexcept {
+  auto &reg = getRegistry();
+  auto path = canonicalPath(file_name);
+
+  std::lock_guard lck(reg.mtx);
+  auto &file = reg.files[path];
+  if (!file) {
+    auto *file_handle = fopen(path.c_str(), "a+");
+    if (!file_handle) {
+      reg.files.erase(path);
+      return nullptr;
+    }
+    file = std::make_unique<SharedFile>();
+    file->file_handle = file_handle;
+    file->sink = StdioSink(file_handle);
+    file->canonical_path = std::move(path);
+#ifdef ITST_NO_ALLOC
+    // Otherwise, stdio allocates the buffer on the first write
+    file->buffer.reset(new (std::nothrow) char[BUFSIZ]);
+    if (file->buffer) {
+      setvbuf(file_handle, file->buffer.get(), _IOFBF, BUFSIZ);
+    }
+#endif
+    BackgroundFlusher::add(file_handle);
+  }
+
+  ++file->ref_count;
+  return file.get();
+}
+
+void FileRegistry::release(SharedFile *file) noexcept {
+  if (!file) {
+    return;
+  }
+
+  auto &reg = getRegistry();
+  std::lock_guard lck(reg.mtx);
+  assert(file->ref_count != 0);
+  if (--file->ref_count) {
+    return;
+  }
+
+  BackgroundFlusher::remove(file->file_handle);
+  fclose(file->file_handle);
+  // Note: Don't pass the member as key, as erasing destroys it
+  auto path = std::move(file->canonical_path);
+  reg.files.erase(path);
+}
+
+FILE *FileRegistry::getFileHandle(const SharedFile *file) noexcept {
+  return file ? file->file_handle : nullptr;
+}
+
+StdioSink *FileRegistry::getSink(SharedFile *file) noexcept {
+  return file ? &file->sink : nullptr;
+}
+
+bool FileRegistry::setBuffering(SharedFile *file, BufferMode mode,
+                                size_t buffer_size) noexcept {
+  if (!file) {
+    return false;
+  }
+
+  std::unique_ptr<char[]> buffer;
+  if (mode != BufferMode::Unbuffered && buffer_size) {
+    buffer.reset(new (std::nothrow) char[buffer_size]);
+    if (!buffer) {
+      return false;
+    }
+  }
+
+  auto &reg = getRegistry();
+  std::lock_guard lck(reg.mtx);
+  if (!setStreamBuffering(file->file_handle, mode, buffer.get(),
+                          buffer_size)) {
+    return false;
+  }
+
+  // The stream no longer refers to the old buffer, so we can release it
+  file->buffer = std::move(buffer);
+  return true;
+}
+
+void FileRegistry::sync(SharedFile *file) noexcept {
+  if (!file) {
+    return;
+  }
+
+  std::unique_lock lck(file->sync_mtx);
+  auto ticket = ++file->num_requested;
+  while (file->num_synced < ticket) {
+    if (file->syncing) {
+      file->sync_cv.wait(lck);
+      continue;
+    }
+
+    // Become the leader of the next sync. The messages of all tickets up to
+    // here are already in the stdio buffer, so the sync covers them.
+    file->syncing = true;
+    auto target = file->num_requested;
+    lck.unlock();
+    syncFile(file->file_handle);
+    lck.lock();
+
+    file->num_synced = target;
+    file->syncing = false;
+    file->sync_cv.notify_all();
+  }
+}
+} // namespace itst
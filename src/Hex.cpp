@@ -0,0 +1,97 @@
+#include "itst/Hex.h"
+
+#include <algorithm>
+#include <array>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ITST_HEX_SSE2 1
+#endif
+
+namespace itst {
+namespace {
+constexpr char HexDigits[] = "0123456789abcdef";
+
+void encodeHexScalar(const std::byte *data, size_t size, char *out) noexcept {
+  for (size_t i = 0; i != size; ++i) {
+    auto byte = std::to_integer<unsigned>(data[i]);
+    out[2 * i] = HexDigits[byte >> 4];
+    out[2 * i + 1] = HexDigits[byte & 0xf];
+  }
+}
+
+#ifdef ITST_HEX_SSE2
+/// Converts nibbles (0..15) to their ASCII hex digits
+inline __m128i nibblesToHex(__m128i nibbles) noexcept {
+  // '0' + n for n < 10, and 'a' + (n - 10) = '0' + n + 39 otherwise
+  auto is_letter = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+  auto digits = _mm_add_epi8(nibbles, _mm_set1_epi8('0'));
+  return _mm_add_epi8(digits, _mm_and_si128(is_letter, _mm_set1_epi8(39)));
+}
+#endif
+} // namespace
+
+void detail::encodeHex(const std::byte *data, size_t size, char *out) noexcept {
+  size_t pos = 0;
+#ifdef ITST_HEX_SSE2
+  const auto low_mask = _mm_set1_epi8(0x0f);
+  for (; pos + 16 <= size; pos += 16) {
+    auto bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    auto high = _mm_and_si128(_mm_srli_epi16(bytes, 4), low_mask);
+    auto low = _mm_and_si128(bytes, low_mask);
+    high = nibblesToHex(high);
+    low = nibblesToHex(low);
+    // Interleave, such that the high nibble comes first
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * pos),
+                     _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * pos + 16),
+                     _mm_unpackhi_epi8(high, low));
+  }
+#endif
+  encodeHexScalar(data + pos, size - pos, out + 2 * pos);
+}
+
+size_t detail::formatHexDumpLine(const std::byte *data, size_t size,
+                                 size_t offset, char *out) noexcept {
+  size = std::min(size, HexDumpBytesPerLine);
+
+  std::array<char, 2 * HexDumpBytesPerLine> hex_digits;
+  encodeHex(data, size, hex_digits.data());
+
+  // Offset
+  for (int i = 7; i >= 0; --i) {
+    out[i] = HexDigits[offset & 0xf];
+    offset >>= 4;
+  }
+  char *pos = out + 8;
+  *pos++ = ' ';
+
+  // Hex columns, with an additional space after eight bytes. Missing bytes in
+  // the last line are padded, such that the ASCII gutter stays aligned
+  for (size_t i = 0; i != HexDumpBytesPerLine; ++i) {
+    *pos++ = ' ';
+    if (i == HexDumpBytesPerLine / 2) {
+      *pos++ = ' ';
+    }
+    if (i < size) {
+      *pos++ = hex_digits[2 * i];
+      *pos++ = hex_digits[2 * i + 1];
+    } else {
+      *pos++ = ' ';
+      *pos++ = ' ';
+    }
+  }
+
+  // ASCII gutter
+  *pos++ = ' ';
+  *pos++ = ' ';
+  *pos++ = '|';
+  for (size_t i = 0; i != size; ++i) {
+    auto chr = std::to_integer<unsigned char>(data[i]);
+    *pos++ = chr >= 0x20 && chr < 0x7f ? char(chr) : '.';
+  }
+  *pos++ = '|';
+  return size_t(pos - out);
+}
+} // namespace itst
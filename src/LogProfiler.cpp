@@ -0,0 +1,286 @@
+#include "itst/LogProfiler.h"
+#include "itst/CallSiteRegistry.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <cstdlib>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace itst {
+namespace {
+struct Volume {
+  uint64_t num_records{};
+  uint64_t num_bytes{};
+};
+
+#ifdef ITST_ENABLE_LOG_PROFILER
+using detail::MaxProfileChunks;
+using detail::ProfileChunk;
+using detail::ProfileChunkSize;
+using detail::ProfileCounter;
+
+Volume load(const ProfileCounter &counter) noexcept {
+  return {counter.num_records.load(std::memory_order_relaxed),
+          counter.num_bytes.load(std::memory_order_relaxed)};
+}
+
+struct ThreadTable {
+  std::array<std::atomic<ProfileChunk *>, MaxProfileChunks> chunks{};
+
+  ThreadTable() noexcept;
+  ~ThreadTable();
+
+  ThreadTable(const ThreadTable &) = delete;
+  ThreadTable &operator=(const ThreadTable &) = delete;
+
+  ProfileCounter &getCounter(uint32_t id) noexcept {
+    auto &chunk = chunks[id / ProfileChunkSize];
+    auto *ret = chunk.load(std::memory_order_relaxed);
+    if (!ret) [[unlikely]] {
+      ret = new ProfileChunk();
+      chunk.store(ret, std::memory_order_release);
+    }
+    return (*ret)[id % ProfileChunkSize];
+  }
+
+  template <typename HandlerFn> void forEach(HandlerFn handler) const {
+    for (uint32_t i = 0; i != MaxProfileChunks; ++i) {
+      if (const auto *chunk = chunks[i].load(std::memory_order_acquire)) {
+        for (uint32_t j = 0; j != ProfileChunkSize; ++j) {
+          handler(i * ProfileChunkSize + j, load((*chunk)[j]));
+        }
+      }
+    }
+  }
+};
+#endif // ITST_ENABLE_LOG_PROFILER
+
+struct Registry {
+  std::mutex mtx;
+#ifdef ITST_ENABLE_LOG_PROFILER
+  std::vector<ThreadTable *> threads;
+#endif
+  /// The volume of the threads that have already exited
+  std::vector<Volume> retired;
+  /// The volume at the last reset()
+  std::vector<Volume> baseline;
+
+  FILE *exit_out{};
+  size_t exit_max_sites{};
+  VolumeOrder exit_order{};
+};
+
+Registry &getRegistry() noexcept {
+  // Intentionally leaked: Threads may still exit during static destruction
+  static auto *reg = new Registry();
+  return *reg;
+}
+
+#ifdef ITST_ENABLE_LOG_PROFILER
+ThreadTable::ThreadTable() noexcept {
+  auto &reg = getRegistry();
+  std::lock_guard lck(reg.mtx);
+  reg.threads.push_back(this);
+}
+
+ThreadTable::~ThreadTable() {
+  auto &reg = getRegistry();
+  std::lock_guard lck(reg.mtx);
+  reg.threads.erase(std::find(reg.threads.begin(), reg.threads.end(), this));
+  forEach([&reg](uint32_t id, Volume volume) {
+    if (volume.num_records) {
+      if (reg.retired.size() <= id) {
+        reg.retired.resize(id + 1);
+      }
+      reg.retired[id].num_records += volume.num_records;
+      reg.retired[id].num_bytes += volume.num_bytes;
+    }
+  });
+  for (auto &chunk : chunks) {
+    delete chunk.load(std::memory_order_relaxed);
+  }
+}
+
+/// Trivially destructible, such that records that are logged while the
+/// thread_locals are destroyed do not touch a destroyed table
+thread_local ThreadTable *current_table = nullptr;
+thread_local bool table_destroyed = false;
+
+struct TableOwner {
+  ThreadTable table;
+
+  TableOwner() noexcept {
+    current_table = &table;
+    detail::profile_chunks = table.chunks.data();
+  }
+  ~TableOwner() {
+    current_table = nullptr;
+    detail::profile_chunks = nullptr;
+    table_destroyed = true;
+  }
+
+  TableOwner(const TableOwner &) = delete;
+  TableOwner &operator=(const TableOwner &) = delete;
+};
+
+ThreadTable *getThreadTable() noexcept {
+  if (current_table || table_destroyed) {
+    return current_table;
+  }
+  static thread_local TableOwner owner;
+  return current_table;
+}
+#endif // ITST_ENABLE_LOG_PROFILER
+
+/// Requires the lock
+std::vector<Volume> mergeLocked(const Registry &reg) {
+  auto ret = reg.retired;
+#ifdef ITST_ENABLE_LOG_PROFILER
+  for (const auto *thread : reg.threads) {
+    thread->forEach([&ret](uint32_t id, Volume volume) {
+      if (volume.num_records) {
+        if (ret.size() <= id) {
+          ret.resize(id + 1);
+        }
+        ret[id].num_records += volume.num_records;
+        ret[id].num_bytes += volume.num_bytes;
+      }
+    });
+  }
+#endif
+  return ret;
+}
+
+std::string_view getFileName(std::string_view path) noexcept {
+  auto slash = path.find_last_of("/\\");
+  return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+void printAtExit() noexcept {
+  auto &reg = getRegistry();
+  FILE *out{};
+  size_t max_sites{};
+  VolumeOrder order{};
+  {
+    std::lock_guard lck(reg.mtx);
+    out = reg.exit_out;
+    max_sites = reg.exit_max_sites;
+    order = reg.exit_order;
+  }
+  LogProfiler::printReport(out, max_sites, order);
+}
+} // namespace
+
+#ifdef ITST_ENABLE_LOG_PROFILER
+thread_local uint64_t detail::profiled_bytes = 0;
+thread_local std::atomic<detail::ProfileChunk *> *detail::profile_chunks =
+    nullptr;
+
+void detail::profileRecordSlow(const CallSite &site,
+                               uint64_t num_bytes) noexcept {
+  if (site.id >= MaxProfiledSites) {
+    return;
+  }
+  if (auto *table = getThreadTable()) {
+    auto &counter = table->getCounter(site.id);
+    counter.num_records.store(
+        counter.num_records.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+    counter.num_bytes.store(
+        counter.num_bytes.load(std::memory_order_relaxed) + num_bytes,
+        std::memory_order_relaxed);
+  }
+}
+#endif // ITST_ENABLE_LOG_PROFILER
+
+std::vector<CallSiteVolume>
+LogProfiler::getTopCallSites(size_t max_sites, VolumeOrder order) noexcept {
+  auto &reg = getRegistry();
+  std::vector<Volume> volumes;
+  {
+    std::lock_guard lck(reg.mtx);
+    volumes = mergeLocked(reg);
+    for (size_t id = 0; id != std::min(volumes.size(), reg.baseline.size());
+         ++id) {
+      volumes[id].num_records -= reg.baseline[id].num_records;
+      volumes[id].num_bytes -= reg.baseline[id].num_bytes;
+    }
+  }
+
+  std::vector<CallSiteVolume> ret;
+  for (const auto *site : CallSiteRegistry::getCallSites()) {
+    if (site->id < volumes.size() && volumes[site->id].num_records) {
+      const auto &volume = volumes[site->id];
+      ret.push_back({site, volume.num_records, volume.num_bytes});
+    }
+  }
+
+  auto key = [order](const CallSiteVolume &volume) {
+    return order == VolumeOrder::Bytes ? volume.num_bytes : volume.num_records;
+  };
+  auto num_top = std::min(max_sites, ret.size());
+  std::partial_sort(ret.begin(), ret.begin() + ptrdiff_t(num_top), ret.end(),
+                    [&key](const auto &lhs, const auto &rhs) {
+                      return key(lhs) > key(rhs);
+                    });
+  ret.resize(num_top);
+  return ret;
+}
+
+void LogProfiler::printReport(FILE *out, size_t max_sites,
+                              VolumeOrder order) noexcept {
+  // All sites, as the totals and percentages also cover the sites that are
+  // not printed
+  auto sites = getTopCallSites(SIZE_MAX, order);
+  auto num_top = std::min(max_sites, sites.size());
+
+  uint64_t total_records = 0;
+  uint64_t total_bytes = 0;
+  for (const auto &volume : sites) {
+    total_records += volume.num_records;
+    total_bytes += volume.num_bytes;
+  }
+
+  flockfile(out);
+  fprintf(out, "Log volume of the top %zu of %zu call-sites (by %s):\n",
+          num_top, sites.size(),
+          order == VolumeOrder::Bytes ? "bytes" : "records");
+  fprintf(out, "%12s %14s %6s  %s\n", "records", "bytes", "bytes%", "site");
+  for (size_t i = 0; i != num_top; ++i) {
+    const auto &[site, num_records, num_bytes] = sites[i];
+    auto file = getFileName(site->file);
+    fprintf(out, "%12" PRIu64 " %14" PRIu64 " %5.1f%%  %.*s:%u (%s) [%s]\n",
+            num_records, num_bytes,
+            total_bytes ? 100.0 * double(num_bytes) / double(total_bytes) : 0,
+            int(file.size()), file.data(), site->line, site->function,
+            to_string(site->severity).data());
+  }
+  fprintf(out,
+          "%12" PRIu64 " %14" PRIu64 "         total of all call-sites\n",
+          total_records, total_bytes);
+  funlockfile(out);
+  fflush(out);
+}
+
+void LogProfiler::reportAtExit(FILE *out, size_t max_sites,
+                               VolumeOrder order) noexcept {
+  auto &reg = getRegistry();
+  std::lock_guard lck(reg.mtx);
+  if (!reg.exit_out) {
+    atexit(&printAtExit);
+  }
+  reg.exit_out = out;
+  reg.exit_max_sites = max_sites;
+  reg.exit_order = order;
+}
+
+void LogProfiler::reset() noexcept {
+  auto &reg = getRegistry();
+  std::lock_guard lck(reg.mtx);
+  reg.baseline = mergeLocked(reg);
+}
+} // namespace itst
@@ -1,7 +1,7 @@
 #include "itst/LogSeverity.h"
 
 #include "itst/common/ErrorHandling.h"
-#include "itst/common/StringSwitch.h"
+#include "itst/common/StringSwitchTable.h"
 
 namespace itst {
 std::string_view to_string(LogSeverity sev) noexcept {
@@ -15,10 +15,11 @@ std::string_view to_string(LogSeverity sev) noexcept {
 }
 
 std::optional<LogSeverity> from_string(std::string_view str) noexcept {
-  return itst::StringSwitch<LogSeverity>(str)
+  static constexpr auto Severities = StringSwitchBuilder<LogSeverity>()
 #define ITST_LOG_SEVERITY(NAME, REP) .Case(#REP, LogSeverity::NAME)
 #include "itst/LogSeverity.def"
-      .NoDefault();
+                                         .Build();
+  return Severities(str).NoDefault();
 }
 
 } // namespace itst
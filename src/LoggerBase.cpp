@@ -1,4 +1,6 @@
 #include "itst/LoggerBase.h"
+#include "itst/Clock.h"
+#include "itst/Context.h"
 
 #include <array>
 #include <cassert>
@@ -10,13 +12,19 @@
 
 namespace itst {
 std::optional<LogSeverity> LoggerBase::global_enforced_log_severity{};
+std::optional<LogSeverity> LoggerBase::global_flush_severity{};
+bool LoggerBase::global_print_thread = false;
 
 #if defined(_GNU_SOURCE) && !defined(ITST_DISABLE_LOGGER)
 auto LoggerBase::FileLock::create(FILE *file_handle) noexcept -> FileLock {
   FileLock Lck;
   Lck.file_handle = file_handle;
-  if (file_handle)
+  Lck.locked = file_handle != nullptr;
+  if (file_handle) {
+    ITST_PROBE1(lock_wait, file_handle);
     flockfile(file_handle);
+    ITST_PROBE1(lock_acquired, file_handle);
+  }
 
   return Lck;
 }
@@ -29,6 +37,9 @@ void LoggerBase::FileLock::destroy() noexcept {
 
 void LoggerBase::FileWriter::operator()(
     std::string_view content) const noexcept {
+#ifdef ITST_ENABLE_LOG_PROFILER
+  detail::profiled_bytes += content.size();
+#endif
 #ifdef _GNU_SOURCE
   /// NOTE: fwrite_unlocked is non-standard, unfortunately. For performance
   /// reasons, call it whenever available
@@ -38,19 +49,80 @@ void LoggerBase::FileWriter::operator()(
 #endif
 }
 
+void LoggerBase::RecordWriter::operator()(
+    std::string_view content) const noexcept {
+#ifdef ITST_ENABLE_LOG_PROFILER
+  detail::profiled_bytes += content.size();
+#endif
+  RecordBuffer::write(content);
+}
+
 void LoggerBase::flushImpl(FILE *file_handle) noexcept { fflush(file_handle); }
 
+void LoggerBase::flushUnlocked(FILE *file_handle) noexcept {
+#ifdef _GNU_SOURCE
+  fflush_unlocked(file_handle);
+#else
+  fflush(file_handle);
+#endif
+}
+
+template <typename Writer>
+void LoggerBase::logErased(Writer writer, LogSeverity msg_sev, bool force,
+                           bool lock_stream,
+                           const std::string_view *fmt_parts,
+                           const ErasedItem<Writer> *items, size_t num_items,
+                           EndLoggingFn<Writer> end_logging) const {
+  auto lock = startLogging(writer, msg_sev, force, lock_stream);
+  if (!lock) {
+    return;
+  }
+
+  Printer<Writer> printer{writer};
+  for (size_t i = 0; i != num_items; ++i) {
+    if (fmt_parts && !fmt_parts[i].empty()) {
+      writer(fmt_parts[i]);
+    }
+    items[i].print(items[i].item, printer);
+  }
+  writer(fmt_parts ? fmt_parts[num_items] : "\n");
+
+  end_logging(*this, std::move(lock), msg_sev);
+}
+
+template void LoggerBase::logErased(FileWriter, LogSeverity, bool, bool,
+                                    const std::string_view *,
+                                    const ErasedItem<FileWriter> *, size_t,
+                                    EndLoggingFn<FileWriter>) const;
+template void LoggerBase::logErased(RecordWriter, LogSeverity, bool, bool,
+                                    const std::string_view *,
+                                    const ErasedItem<RecordWriter> *, size_t,
+                                    EndLoggingFn<RecordWriter>) const;
+
+template <typename Writer>
 void LoggerBase::printHeader(LogSeverity msg_sev,
-                             FileWriter writer) const noexcept {
+                             Writer writer) const noexcept {
   writer("[");
   printTimestamp(writer);
   writer("][");
   writer(to_string(msg_sev));
   writer("][");
   writer(class_name);
-  writer("]: ");
+  writer("]");
+  if (global_print_thread) {
+    writer(detail::getThreadField());
+  }
+  if (const auto *context = detail::getContextBuffer();
+      context && !context->empty()) {
+    writer(*context);
+  }
+  writer(": ");
 }
 
+template void LoggerBase::printHeader(LogSeverity, FileWriter) const noexcept;
+template void LoggerBase::printHeader(LogSeverity,
+                                      RecordWriter) const noexcept;
+
 static constexpr std::array<char, 200> digits() noexcept {
   std::array<char, 200> ret{};
 
@@ -64,20 +136,31 @@ static constexpr std::array<char, 200> digits() noexcept {
   return ret;
 }
 
-void LoggerBase::printTimestamp(FileWriter writer) noexcept {
+template <typename Writer>
+void LoggerBase::printTimestamp(Writer writer) noexcept {
+  printTimestamp(writer, Clock::getRealtime());
+}
 
-  static constexpr auto Digits = digits();
+template <typename Writer>
+void LoggerBase::printTimestamp(Writer writer,
+                                timespec current_time) noexcept {
 
-  struct timespec current_time {};
-  clock_gettime(CLOCK_REALTIME, &current_time);
+  static constexpr auto Digits = digits();
 
-  struct tm current_local_time = {};
+  // localtime_r is expensive (it takes a global lock for the timezone), so
+  // only call it once per second and thread
+  static thread_local time_t cached_seconds = -1;
+  static thread_local struct tm cached_local_time = {};
+  if (current_time.tv_sec != cached_seconds) {
 #ifdef _MSC_VER
-  // For whatever reason the parameters on msvc are swapped
-  localtime_s(&current_local_time, &current_time.tv_sec);
+    // For whatever reason the parameters on msvc are swapped
+    localtime_s(&cached_local_time, &current_time.tv_sec);
 #else
-  localtime_r(&current_time.tv_sec, &current_local_time);
+    localtime_r(&current_time.tv_sec, &cached_local_time);
 #endif
+    cached_seconds = current_time.tv_sec;
+  }
+  const auto &current_local_time = cached_local_time;
   auto year = current_local_time.tm_year + 1900;
   auto month = current_local_time.tm_mon + 1;
   auto day = current_local_time.tm_mday;
@@ -129,4 +212,9 @@ void LoggerBase::printTimestamp(FileWriter writer) noexcept {
   writer(std::string_view(buf.data(), ptr - buf.data()));
 }
 
+template void LoggerBase::printTimestamp(FileWriter) noexcept;
+template void LoggerBase::printTimestamp(RecordWriter) noexcept;
+template void LoggerBase::printTimestamp(FileWriter, timespec) noexcept;
+template void LoggerBase::printTimestamp(RecordWriter, timespec) noexcept;
+
 } // namespace itst
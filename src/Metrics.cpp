@@ -0,0 +1,340 @@
+#include "itst/Metrics.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace itst {
+namespace {
+constexpr uint32_t MaxMetrics = 1024;
+
+// Log-linear histogram: Each power of two is split into 1 << SubBucketBits
+// linear buckets, which bounds the relative error to 25%
+constexpr unsigned SubBucketBits = 2;
+constexpr size_t NumBuckets = size_t(64) << SubBucketBits;
+
+constexpr size_t getBucket(uint64_t value) noexcept {
+  if (value < (1U << SubBucketBits)) {
+    return value;
+  }
+  unsigned msb = 63 - __builtin_clzll(value);
+  auto sub = (value >> (msb - SubBucketBits)) & ((1U << SubBucketBits) - 1);
+  return ((msb - SubBucketBits + 1) << SubBucketBits) + sub;
+}
+
+constexpr uint64_t getBucketUpperBound(size_t bucket) noexcept {
+  if (bucket < (1U << SubBucketBits)) {
+    return bucket;
+  }
+  auto msb = (bucket >> SubBucketBits) + SubBucketBits - 1;
+  auto sub = bucket & ((1U << SubBucketBits) - 1);
+  auto lower = ((uint64_t(1) << SubBucketBits) + sub) << (msb - SubBucketBits);
+  return lower + (uint64_t(1) << (msb - SubBucketBits)) - 1;
+}
+
+static_assert(getBucket(5) == 5);
+static_assert(getBucketUpperBound(getBucket(1000)) >= 1000);
+static_assert(getBucket(~uint64_t(0)) < NumBuckets);
+
+/// Only written by the owning thread, so updates need no read-modify-write;
+/// the atomics just make the concurrent reads by the reporter well-defined
+void add(std::atomic<uint64_t> &value, uint64_t num) noexcept {
+  value.store(value.load(std::memory_order_relaxed) + num,
+              std::memory_order_relaxed);
+}
+
+struct Slot {
+  std::atomic<uint64_t> count{};
+  std::atomic<uint64_t> sum{};
+  /// Only allocated for timers
+  std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+};
+
+struct Totals {
+  uint64_t count{};
+  uint64_t sum{};
+  std::vector<uint64_t> buckets;
+
+  void add(const Slot &slot) {
+    count += slot.count.load(std::memory_order_relaxed);
+    sum += slot.sum.load(std::memory_order_relaxed);
+    if (slot.buckets) {
+      buckets.resize(NumBuckets);
+      for (size_t i = 0; i != NumBuckets; ++i) {
+        buckets[i] += slot.buckets[i].load(std::memory_order_relaxed);
+      }
+    }
+  }
+};
+
+struct ThreadMetrics {
+  std::array<std::atomic<Slot *>, MaxMetrics> slots{};
+
+  ThreadMetrics() noexcept;
+  ~ThreadMetrics();
+
+  ThreadMetrics(const ThreadMetrics &) = delete;
+  ThreadMetrics &operator=(const ThreadMetrics &) = delete;
+
+  Slot &getSlot(uint32_t id, MetricKind kind) noexcept {
+    if (auto *slot = slots[id].load(std::memory_order_relaxed)) {
+      return *slot;
+    }
+    auto *slot = new Slot();
+    if (kind == MetricKind::Timer) {
+      slot->buckets.reset(new std::atomic<uint64_t>[NumBuckets]());
+    }
+    slots[id].store(slot, std::memory_order_release);
+    return *slot;
+  }
+};
+
+struct Registry {
+  std::mutex mtx;
+  std::vector<std::pair<std::string, MetricKind>> metrics;
+  std::vector<ThreadMetrics *> threads;
+  /// The metrics of the threads that have already exited
+  std::vector<Totals> retired;
+  std::vector<Totals> last_report;
+
+  std::condition_variable cv;
+  std::thread reporter;
+  bool running = false;
+  std::chrono::milliseconds interval{};
+  const void *logger{};
+  MetricsReporter::EmitFn emit{};
+  LogSeverity sev{};
+};
+
+Registry &getRegistry() noexcept {
+  // Intentionally leaked: Threads may still exit during static destruction
+  static auto *reg = new Registry();
+  return *reg;
+}
+
+ThreadMetrics::ThreadMetrics() noexcept {
+  auto &reg = getRegistry();
+  std::lock_guard lck(reg.mtx);
+  reg.threads.push_back(this);
+}
+
+ThreadMetrics::~ThreadMetrics() {
+  auto &reg = getRegistry();
+  std::lock_guard lck(reg.mtx);
+  reg.threads.erase(std::find(reg.threads.begin(), reg.threads.end(), this));
+  for (uint32_t id = 0; id != MaxMetrics; ++id) {
+    if (auto *slot = slots[id].load(std::memory_order_acquire)) {
+      reg.retired[id].add(*slot);
+      delete slot;
+    }
+  }
+}
+
+ThreadMetrics &getThreadMetrics() noexcept {
+  static thread_local ThreadMetrics metrics;
+  return metrics;
+}
+
+void appendDuration(std::string &out, double nanos) {
+  static constexpr std::pair<double, const char *> Units[] = {
+      {1e9, "s"}, {1e6, "ms"}, {1e3, "us"}, {1, "ns"}};
+  const auto *unit = std::find_if(std::begin(Units), std::end(Units) - 1,
+                                  [nanos](auto unit) {
+                                    return nanos >= unit.first;
+                                  });
+  std::array<char, 32> buf{};
+  auto len =
+      snprintf(buf.data(), buf.size(), "%.3g%s", nanos / unit->first,
+               unit->second);
+  out.append(buf.data(), size_t(len));
+}
+
+uint64_t getPercentile(const std::vector<uint64_t> &buckets,
+                       double quantile) noexcept {
+  // The count and the buckets are not read atomically together, so use the
+  // buckets' total as reference
+  uint64_t count = 0;
+  for (auto num : buckets) {
+    count += num;
+  }
+  auto rank = std::max<uint64_t>(1, uint64_t(double(count) * quantile));
+  uint64_t seen = 0;
+  for (size_t i = 0; i != buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return getBucketUpperBound(i);
+    }
+  }
+  return 0;
+}
+
+/// Computes the deltas since the last report. Requires the lock
+std::string summarizeLocked(Registry &reg) {
+  std::string summary;
+  for (uint32_t id = 0; id != reg.metrics.size(); ++id) {
+    Totals curr = reg.retired[id];
+    for (auto *thread : reg.threads) {
+      if (auto *slot = thread->slots[id].load(std::memory_order_acquire)) {
+        curr.add(*slot);
+      }
+    }
+
+    auto &last = reg.last_report[id];
+    auto count = curr.count - last.count;
+    if (count) {
+      const auto &[name, kind] = reg.metrics[id];
+      if (!summary.empty()) {
+        summary += "; ";
+      }
+      summary += name;
+      summary += ": ";
+
+      if (kind == MetricKind::Counter) {
+        summary += std::to_string(curr.sum - last.sum);
+      } else {
+        std::vector<uint64_t> buckets(NumBuckets);
+        last.buckets.resize(NumBuckets);
+        curr.buckets.resize(NumBuckets);
+        for (size_t i = 0; i != NumBuckets; ++i) {
+          buckets[i] = curr.buckets[i] - last.buckets[i];
+        }
+
+        summary += "n=";
+        summary += std::to_string(count);
+        summary += " mean=";
+        appendDuration(summary, double(curr.sum - last.sum) / double(count));
+        for (auto [label, quantile] :
+             {std::pair{" p50=", 0.5}, {" p90=", 0.9}, {" p99=", 0.99},
+              {" max=", 1.0}}) {
+          summary += label;
+          appendDuration(summary, double(getPercentile(buckets, quantile)));
+        }
+      }
+    }
+
+    last = std::move(curr);
+  }
+  return summary;
+}
+
+void runReporter(Registry &reg) noexcept {
+  std::unique_lock lck(reg.mtx);
+  while (reg.running) {
+    reg.cv.wait_for(lck, reg.interval);
+    if (!reg.running) {
+      break;
+    }
+    lck.unlock();
+    MetricsReporter::report();
+    lck.lock();
+  }
+}
+} // namespace
+
+MetricId::MetricId(std::string_view name, MetricKind kind) noexcept {
+  auto &reg = getRegistry();
+  std::lock_guard lck(reg.mtx);
+  auto it = std::find_if(reg.metrics.begin(), reg.metrics.end(),
+                         [name](const auto &metric) {
+                           return metric.first == name;
+                         });
+  if (it != reg.metrics.end()) {
+    id = uint32_t(it - reg.metrics.begin());
+    return;
+  }
+
+  id = uint32_t(reg.metrics.size());
+  if (id >= MaxMetrics) {
+    fputs("Too many metrics; ignoring the new ones\n", stderr);
+    id = MaxMetrics;
+    return;
+  }
+  reg.metrics.emplace_back(name, kind);
+  reg.retired.emplace_back();
+  reg.last_report.emplace_back();
+}
+
+void detail::recordDuration(const MetricId &metric, uint64_t nanos) noexcept {
+  auto id = metric.getId();
+  if (id >= MaxMetrics) {
+    return;
+  }
+  auto &slot = getThreadMetrics().getSlot(id, MetricKind::Timer);
+  add(slot.count, 1);
+  add(slot.sum, nanos);
+  if (slot.buckets) {
+    add(slot.buckets[getBucket(nanos)], 1);
+  }
+}
+
+void detail::addToCounter(const MetricId &metric, uint64_t num) noexcept {
+  auto id = metric.getId();
+  if (id >= MaxMetrics) {
+    return;
+  }
+  auto &slot = getThreadMetrics().getSlot(id, MetricKind::Counter);
+  add(slot.count, 1);
+  add(slot.sum, num);
+}
+
+void MetricsReporter::startImpl(const void *logger, EmitFn emit,
+                                std::chrono::milliseconds interval,
+                                LogSeverity sev) noexcept {
+  auto &reg = getRegistry();
+  std::lock_guard lck(reg.mtx);
+  reg.logger = logger;
+  reg.emit = emit;
+  reg.sev = sev;
+  reg.interval = std::max(interval, std::chrono::milliseconds(1));
+  if (reg.running) {
+    reg.cv.notify_one();
+    return;
+  }
+
+  reg.running = true;
+  reg.reporter = std::thread(runReporter, std::ref(reg));
+}
+
+void MetricsReporter::stop() noexcept {
+  auto &reg = getRegistry();
+  std::thread thread;
+  {
+    std::lock_guard lck(reg.mtx);
+    if (!reg.running) {
+      return;
+    }
+    reg.running = false;
+    thread = std::move(reg.reporter);
+  }
+
+  reg.cv.notify_one();
+  thread.join();
+  report();
+}
+
+void MetricsReporter::report() noexcept {
+  auto &reg = getRegistry();
+  std::unique_lock lck(reg.mtx);
+  if (!reg.emit) {
+    return;
+  }
+
+  auto summary = summarizeLocked(reg);
+  const auto *logger = reg.logger;
+  auto emit = reg.emit;
+  auto sev = reg.sev;
+  lck.unlock();
+
+  if (!summary.empty()) {
+    emit(logger, sev, summary);
+  }
+}
+} // namespace itst
@@ -0,0 +1,149 @@
+#include "itst/RecordBuffer.h"
+#include "itst/Core.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace itst {
+namespace {
+/// Records nested deeper than this share the begin of the innermost one
+constexpr size_t MaxNesting = 16;
+
+#ifdef ITST_NO_ALLOC
+/// The fixed size of each thread's staging buffer; longer records are
+/// truncated
+constexpr size_t InitialCapacity = 16 * 1024;
+#else
+/// The buffer grows as needed
+constexpr size_t InitialCapacity = 4096;
+#endif
+
+// NOLINTBEGIN(cppcoreguidelines-no-malloc)
+struct StagingBuffer {
+  char *data{};
+  size_t size = 0;
+  size_t capacity = 0;
+  /// Set if the open records did not fit into the buffer
+  bool truncated = false;
+
+  /// The offsets at which the open records begin
+  std::array<size_t, MaxNesting> begins{};
+  size_t depth = 0;
+
+  StagingBuffer() noexcept {
+    data = static_cast<char *>(malloc(InitialCapacity));
+#ifndef ITST_DISABLE_ASSERT
+    if (!data) {
+      perror("Failed to allocate the staging buffer");
+      ITST_BUILTIN_TRAP;
+    }
+#endif // ITST_DISABLE_ASSERT
+    capacity = data ? InitialCapacity : 0;
+  }
+
+  ~StagingBuffer() { free(data); }
+
+  StagingBuffer(const StagingBuffer &) = delete;
+  StagingBuffer &operator=(const StagingBuffer &) = delete;
+
+  [[nodiscard]] size_t getBegin() const noexcept {
+    return depth ? begins[std::min(depth, MaxNesting) - 1] : 0;
+  }
+
+  /// Makes room for len more bytes, if possible. Returns how many fit.
+  size_t reserve(size_t len) noexcept {
+#ifndef ITST_NO_ALLOC
+    if (capacity - size < len) {
+      auto new_capacity = std::max(capacity * 2, size + len);
+      if (auto *new_data = static_cast<char *>(realloc(data, new_capacity))) {
+        data = new_data;
+        capacity = new_capacity;
+      }
+    }
+#endif
+    return std::min(len, capacity - size);
+  }
+
+  void write(std::string_view content) noexcept {
+    auto len = reserve(content.size());
+    if (len != content.size()) {
+      truncated = true;
+    }
+    if (len) {
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      memcpy(data + size, content.data(), len);
+      size += len;
+    }
+  }
+};
+// NOLINTEND(cppcoreguidelines-no-malloc)
+
+/// Trivially destructible, such that it stays accessible while the thread's
+/// thread_locals are destroyed and, for the main thread, also while the
+/// statics are destroyed; all loggers may still be used there.
+thread_local StagingBuffer *current_buffer = nullptr;
+
+struct BufferOwner {
+  BufferOwner() = default;
+  ~BufferOwner() {
+    delete current_buffer;
+    current_buffer = nullptr;
+  }
+
+  BufferOwner(const BufferOwner &) = delete;
+  BufferOwner &operator=(const BufferOwner &) = delete;
+};
+
+StagingBuffer &getStagingBuffer() noexcept {
+  if (current_buffer) {
+    return *current_buffer;
+  }
+
+  current_buffer = new StagingBuffer();
+  // Note: If the thread is exiting already, the owner is not constructed
+  // again, so the buffer leaks. This only happens for messages that are
+  // logged from destructors of thread_locals or statics.
+  static thread_local BufferOwner owner;
+  return *current_buffer;
+}
+} // namespace
+
+void RecordBuffer::preallocate() noexcept { (void)getStagingBuffer(); }
+
+void RecordBuffer::begin() noexcept {
+  auto &buffer = getStagingBuffer();
+  if (buffer.depth && buffer.depth < MaxNesting) {
+    // Only nested records need the position; the outermost one begins at 0
+    buffer.begins[buffer.depth] = buffer.size;
+  }
+  ++buffer.depth;
+}
+
+void RecordBuffer::write(std::string_view content) noexcept {
+  getStagingBuffer().write(content);
+}
+
+std::string_view RecordBuffer::view() noexcept {
+  auto &buffer = getStagingBuffer();
+  auto begin = buffer.getBegin();
+  if (buffer.truncated && buffer.size > begin) {
+    // Keep the line structure of a truncated record
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    buffer.data[buffer.size - 1] = '\n';
+  }
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  return {buffer.data + begin, buffer.size - begin};
+}
+
+void RecordBuffer::reset() noexcept {
+  auto &buffer = getStagingBuffer();
+  buffer.size = buffer.getBegin();
+  buffer.truncated = false;
+  if (buffer.depth) {
+    --buffer.depth;
+  }
+}
+} // namespace itst
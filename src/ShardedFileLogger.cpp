@@ -0,0 +1,142 @@
+#include "itst/ShardedFileLogger.h"
+#include "itst/Context.h"
+#include "itst/Core.h"
+
+#include <array>
+#include <charconv>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace itst {
+namespace {
+struct Registry {
+  std::mutex mtx;
+  std::vector<std::string> base_names;
+};
+
+Registry &getRegistry() noexcept {
+  // Intentionally leaked: Threads may still open shards during static
+  // destruction
+  static auto *reg = new Registry();
+  return *reg;
+}
+
+size_t registerBaseName(const char *base_name) noexcept {
+  auto &reg = getRegistry();
+  std::lock_guard lck(reg.mtx);
+  for (size_t i = 0; i != reg.base_names.size(); ++i) {
+    if (reg.base_names[i] == base_name) {
+      return i;
+    }
+  }
+  reg.base_names.emplace_back(base_name);
+  return reg.base_names.size() - 1;
+}
+
+std::string getShardName(size_t base_id) {
+  std::string ret;
+  {
+    auto &reg = getRegistry();
+    std::lock_guard lck(reg.mtx);
+    ret = reg.base_names[base_id];
+  }
+
+  std::array<char, sizeof("18446744073709551615")> buf{};
+  auto [ptr, err] = std::to_chars(buf.data(), buf.data() + buf.size(),
+                                  detail::getThreadId());
+  ret += '.';
+  ret.append(buf.data(), ptr);
+  ret += ".log";
+  return ret;
+}
+
+/// The shards of one thread, indexed by the id of their base name
+struct ThreadShards {
+  std::vector<FILE *> files;
+
+  ThreadShards() noexcept = default;
+  ~ThreadShards() {
+    for (auto *file : files) {
+      if (file) {
+        fclose(file);
+      }
+    }
+  }
+
+  ThreadShards(const ThreadShards &) = delete;
+  ThreadShards &operator=(const ThreadShards &) = delete;
+
+  FILE *open(size_t base_id) noexcept {
+    if (files.size() <= base_id) {
+      files.resize(base_id + 1);
+    }
+    auto &file = files[base_id];
+    if (!file) {
+      file = fopen(getShardName(base_id).c_str(), "a");
+    }
+    return file;
+  }
+};
+
+/// Trivially destructible, such that messages that are logged while the
+/// thread_locals are destroyed do not touch destroyed shards
+thread_local ThreadShards *current_shards = nullptr;
+thread_local bool shards_destroyed = false;
+
+struct ShardsOwner {
+  ThreadShards shards;
+
+  ShardsOwner() noexcept { current_shards = &shards; }
+  ~ShardsOwner() {
+    current_shards = nullptr;
+    shards_destroyed = true;
+  }
+
+  ShardsOwner(const ShardsOwner &) = delete;
+  ShardsOwner &operator=(const ShardsOwner &) = delete;
+};
+
+ThreadShards *getThreadShards() noexcept {
+  if (current_shards || shards_destroyed) {
+    return current_shards;
+  }
+  static thread_local ShardsOwner owner;
+  return current_shards;
+}
+} // namespace
+
+ShardedFileLogger::ShardedFileLogger(const char *base_name,
+                                     std::string_view class_name,
+                                     LogSeverity sev) noexcept
+    : LoggerImpl(class_name, sev), base_id(registerBaseName(base_name)) {}
+
+FILE *ShardedFileLogger::getFileHandle() const noexcept {
+  auto *shards = getThreadShards();
+  if (!shards) {
+    return nullptr;
+  }
+  if (base_id < shards->files.size()) {
+    if (auto *file = shards->files[base_id]) {
+      return file;
+    }
+  }
+
+  auto *file = shards->open(base_id);
+#ifndef ITST_DISABLE_ASSERT
+  if (!file) {
+    perror("Failed to open the shard of the log file");
+    ITST_BUILTIN_TRAP;
+  }
+#endif // ITST_DISABLE_ASSERT
+  return file;
+}
+
+void ShardedFileLogger::flush() const noexcept {
+  if (auto *shards = current_shards;
+      shards && base_id < shards->files.size() && shards->files[base_id]) {
+    flushUnlocked(shards->files[base_id]);
+  }
+}
+} // namespace itst
@@ -0,0 +1,304 @@
+#include "itst/SharedMemoryLogger.h"
+#include "itst/Core.h"
+
+#include "SharedMemoryRingLayout.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace itst {
+using namespace detail;
+
+namespace {
+size_t roundCapacity(size_t capacity) noexcept {
+  size_t ret = MinCapacity;
+  while (ret < capacity) {
+    ret <<= 1;
+  }
+  return ret;
+}
+
+std::string getShmName(const char *name) {
+  return name[0] == '/' ? std::string(name) : '/' + std::string(name);
+}
+} // namespace
+
+struct SharedMemoryRing::Impl {
+  RingHeader *header{};
+  char *data{};
+  size_t mapped_size{};
+  uint64_t mask{};
+
+  /// Consumer-side state to detect crashed producers
+  uint64_t stalled_pos = ~uint64_t(0);
+  std::chrono::steady_clock::time_point stalled_since{};
+
+  bool open(const std::string &name, size_t capacity) noexcept;
+
+  [[nodiscard]] RecordHeader &getRecord(uint64_t pos) const noexcept {
+    return *reinterpret_cast<RecordHeader *>(data + (pos & mask));
+  }
+
+  /// The payload of the record at pos
+  [[nodiscard]] char *getPayload(uint64_t pos) const noexcept {
+    return data + (pos & mask) + sizeof(RecordHeader);
+  }
+
+  /// Zeroes the consumed range, such that the records that are reserved there
+  /// later are not mistaken as committed
+  void clear(uint64_t from, uint64_t to) const noexcept;
+
+  bool isStalled(uint64_t pos) noexcept;
+
+  /// The position of the first record after pos whose header has been
+  /// published, or end if there is none
+  [[nodiscard]] uint64_t findNextHeader(uint64_t pos,
+                                        uint64_t end) const noexcept;
+};
+
+bool SharedMemoryRing::Impl::open(const std::string &name,
+                                  size_t capacity) noexcept {
+  capacity = roundCapacity(capacity);
+  bool created = true;
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (fd < 0 && errno == EEXIST) {
+    created = false;
+    fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0600);
+  }
+  if (fd < 0) {
+    return false;
+  }
+
+  if (created) {
+    if (ftruncate(fd, off_t(sizeof(RingHeader) + capacity)) != 0) {
+      close(fd);
+      shm_unlink(name.c_str());
+      return false;
+    }
+  } else {
+    // Wait until the creator has set the size and initialized the header
+    struct stat info {};
+    for (int i = 0; i != 1000; ++i) {
+      if (fstat(fd, &info) == 0 && size_t(info.st_size) > sizeof(RingHeader)) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (size_t(info.st_size) <= sizeof(RingHeader)) {
+      close(fd);
+      return false;
+    }
+    capacity = size_t(info.st_size) - sizeof(RingHeader);
+  }
+
+  mapped_size = sizeof(RingHeader) + capacity;
+  auto *mem =
+      mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    return false;
+  }
+
+  header = static_cast<RingHeader *>(mem);
+  data = static_cast<char *>(mem) + sizeof(RingHeader);
+  if (created) {
+    // Note: ftruncate zero-initializes the memory
+    header->capacity = capacity;
+    header->magic.store(RingMagic, std::memory_order_release);
+  } else {
+    for (int i = 0; i != 1000; ++i) {
+      if (header->magic.load(std::memory_order_acquire) == RingMagic) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (header->magic.load(std::memory_order_acquire) != RingMagic ||
+        header->capacity != capacity) {
+      munmap(mem, mapped_size);
+      header = nullptr;
+      return false;
+    }
+  }
+
+  mask = capacity - 1;
+  return true;
+}
+
+void SharedMemoryRing::Impl::clear(uint64_t from, uint64_t to) const noexcept {
+  while (from != to) {
+    auto offset = from & mask;
+    auto len = std::min<uint64_t>(to - from, mask + 1 - offset);
+    memset(data + offset, 0, len);
+    from += len;
+  }
+}
+
+bool SharedMemoryRing::Impl::isStalled(uint64_t pos) noexcept {
+  auto now = std::chrono::steady_clock::now();
+  if (pos != stalled_pos) {
+    stalled_pos = pos;
+    stalled_since = now;
+    return false;
+  }
+  return now - stalled_since > StallTimeout;
+}
+
+uint64_t SharedMemoryRing::Impl::findNextHeader(uint64_t pos,
+                                                uint64_t end) const noexcept {
+  // Note: The records start at multiples of RecordAlign, and a published
+  // header is never zero
+  for (pos += RecordAlign; pos != end; pos += RecordAlign) {
+    if (getRecord(pos).state_len.load(std::memory_order_acquire) != 0) {
+      break;
+    }
+  }
+  return pos;
+}
+
+SharedMemoryRing::SharedMemoryRing(const char *name, size_t capacity) noexcept
+    : impl(new Impl()) {
+  if (!impl->open(getShmName(name), capacity)) {
+#ifndef ITST_DISABLE_ASSERT
+    perror("Failed to open the shared memory ring");
+    ITST_BUILTIN_TRAP;
+#endif // ITST_DISABLE_ASSERT
+  }
+}
+
+SharedMemoryRing::~SharedMemoryRing() {
+  if (impl->header) {
+    munmap(impl->header, impl->mapped_size);
+  }
+  delete impl;
+}
+
+bool SharedMemoryRing::isValid() const noexcept {
+  return impl->header != nullptr;
+}
+
+bool SharedMemoryRing::write(std::string_view record) noexcept {
+  auto *header = impl->header;
+  if (!header) {
+    return false;
+  }
+
+  // Drops also take a sequence number, such that they show up as gaps
+  auto seq = header->next_seq.fetch_add(1, std::memory_order_relaxed);
+  auto capacity = impl->mask + 1;
+  auto size = alignRecord(sizeof(RecordHeader) + record.size());
+  if (record.size() > MaxRecordLength || size > capacity / 4) {
+    header->num_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  auto pos = header->write_pos.load(std::memory_order_relaxed);
+  uint64_t padding = 0;
+  do {
+    // Records are contiguous, so skip the rest of the ring, if the record
+    // does not fit anymore
+    auto to_end = capacity - (pos & impl->mask);
+    padding = size <= to_end ? 0 : to_end;
+    auto read_pos = header->read_pos.load(std::memory_order_acquire);
+    if (pos + padding + size - read_pos > capacity) {
+      header->num_dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  } while (!header->write_pos.compare_exchange_weak(
+      pos, pos + padding + size, std::memory_order_acquire,
+      std::memory_order_relaxed));
+
+  if (padding) {
+    impl->getRecord(pos).state_len.store(Padding | uint32_t(padding),
+                                         std::memory_order_release);
+    pos += padding;
+  }
+
+  auto &rec = impl->getRecord(pos);
+  auto len = uint32_t(record.size());
+  // Publish the length first, such that the collector can skip the record,
+  // if this process crashes before committing it
+  rec.state_len.store(Reserved | len, std::memory_order_relaxed);
+  // The header must be visible before any byte of the payload, see read()
+  std::atomic_thread_fence(std::memory_order_release);
+  rec.seq = seq;
+  memcpy(impl->getPayload(pos), record.data(), record.size());
+  rec.state_len.store(Committed | len, std::memory_order_release);
+  return true;
+}
+
+size_t SharedMemoryRing::read(ReadFn read_fn, void *context,
+                              size_t max_records) noexcept {
+  auto *header = impl->header;
+  if (!header) {
+    return 0;
+  }
+
+  auto begin = header->read_pos.load(std::memory_order_relaxed);
+  auto write_pos = header->write_pos.load(std::memory_order_acquire);
+  auto pos = begin;
+  size_t num_read = 0;
+
+  while (pos != write_pos && num_read < max_records) {
+    auto &rec = impl->getRecord(pos);
+    auto state_len = rec.state_len.load(std::memory_order_acquire);
+    auto state = state_len & StateMask;
+    auto len = state_len & ~StateMask;
+
+    if (state == Committed) {
+      read_fn(context, rec.seq, std::string_view(impl->getPayload(pos), len));
+      ++num_read;
+      pos += alignRecord(sizeof(RecordHeader) + len);
+    } else if (state == Padding) {
+      pos += len;
+    } else if (!impl->isStalled(pos)) {
+      // The record is not written completely yet
+      break;
+    } else if (state == Reserved) {
+      // The producer crashed while writing the record
+      header->num_dropped.fetch_add(1, std::memory_order_relaxed);
+      pos += alignRecord(sizeof(RecordHeader) + len);
+    } else {
+      // The producer crashed right after reserving the record, so its length
+      // is unknown. As nothing has been written into it, the record is still
+      // all zeros and ends at the next published header. Note: If there is
+      // none yet, skipping further could take the records of producers that
+      // are still writing
+      auto next = impl->findNextHeader(pos, write_pos);
+      if (next == write_pos) {
+        break;
+      }
+      header->num_dropped.fetch_add(1, std::memory_order_relaxed);
+      pos = next;
+    }
+  }
+
+  if (pos != begin) {
+    impl->clear(begin, pos);
+    header->read_pos.store(pos, std::memory_order_release);
+  }
+  return num_read;
+}
+
+uint64_t SharedMemoryRing::getNumDropped() const noexcept {
+  return impl->header
+             ? impl->header->num_dropped.load(std::memory_order_relaxed)
+             : 0;
+}
+
+size_t SharedMemoryRing::getCapacity() const noexcept {
+  return impl->header ? size_t(impl->mask + 1) : 0;
+}
+
+bool SharedMemoryRing::remove(const char *name) noexcept {
+  return shm_unlink(getShmName(name).c_str()) == 0;
+}
+} // namespace itst
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace itst::detail {
+
+/// The layout of a SharedMemoryRing in the shared memory, which is shared by
+/// all processes that map the ring. Private to the library and its tests.
+
+constexpr uint64_t RingMagic = 0x31474e4952545349; // "ITSTRING1"
+constexpr size_t MinCapacity = 4096;
+constexpr size_t RecordAlign = 8;
+/// If a reserved record is not committed within this time, its producer has
+/// probably crashed
+constexpr auto StallTimeout = std::chrono::seconds(1);
+
+/// The state of a record is stored in the upper bits of its first word, the
+/// length (of the payload or of the padding) in the lower ones
+enum RecordState : uint32_t {
+  Reserved = 1U << 30,
+  Committed = 2U << 30,
+  Padding = 3U << 30,
+};
+constexpr uint32_t StateMask = 3U << 30;
+constexpr uint32_t MaxRecordLength = ~StateMask;
+
+struct RecordHeader {
+  std::atomic<uint32_t> state_len;
+  uint32_t reserved;
+  uint64_t seq;
+};
+static_assert(sizeof(RecordHeader) == 16);
+static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+                  std::atomic<uint64_t>::is_always_lock_free,
+              "The ring is shared between processes and must not use locks");
+
+/// Followed by the records
+struct alignas(64) RingHeader {
+  std::atomic<uint64_t> magic;
+  uint64_t capacity;
+  alignas(64) std::atomic<uint64_t> write_pos;
+  alignas(64) std::atomic<uint64_t> read_pos;
+  alignas(64) std::atomic<uint64_t> next_seq;
+  std::atomic<uint64_t> num_dropped;
+};
+
+constexpr size_t alignRecord(size_t size) noexcept {
+  return (size + RecordAlign - 1) & ~(RecordAlign - 1);
+}
+} // namespace itst::detail
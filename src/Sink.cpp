@@ -0,0 +1,43 @@
+#include "itst/Sink.h"
+#include "itst/Probes.h"
+
+namespace itst {
+namespace {
+void writeUnlockedImpl(const void *data, size_t size,
+                       FILE *file_handle) noexcept {
+#if defined(_GNU_SOURCE)
+  fwrite_unlocked(data, 1, size, file_handle);
+#elif defined(_MSC_VER)
+  _fwrite_nolock(data, 1, size, file_handle);
+#else
+  fwrite(data, 1, size, file_handle);
+#endif
+}
+} // namespace
+
+void StdioSink::writeImpl(const iovec *slices, size_t num_slices) noexcept {
+  ITST_PROBE1(lock_wait, file_handle);
+#if defined(_GNU_SOURCE)
+  flockfile(file_handle);
+#elif defined(_MSC_VER)
+  _lock_file(file_handle);
+#endif
+  ITST_PROBE1(lock_acquired, file_handle);
+
+  for (size_t i = 0; i != num_slices; ++i) {
+    writeUnlockedImpl(slices[i].iov_base, slices[i].iov_len, file_handle);
+  }
+
+#if defined(_GNU_SOURCE)
+  funlockfile(file_handle);
+#elif defined(_MSC_VER)
+  _unlock_file(file_handle);
+#endif
+}
+
+void StdioSink::writeUnlocked(std::string_view record) noexcept {
+  writeUnlockedImpl(record.data(), record.size(), file_handle);
+}
+
+void StdioSink::flushImpl() noexcept { fflush(file_handle); }
+} // namespace itst
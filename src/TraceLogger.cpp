@@ -0,0 +1,377 @@
+#include "itst/TraceLogger.h"
+#include "itst/Buffering.h"
+#include "itst/Context.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace itst {
+namespace {
+std::atomic<TraceSink *> global_sink{};
+std::atomic<uint64_t> next_sink_id{};
+
+struct TraceEvent {
+  char phase{};
+  LogSeverity sev{};
+  uint64_t time_ns{};
+  uint64_t duration_ns{};
+  /// Static names of spans
+  const char *name{};
+  /// Dynamic names of instant events
+  std::string message;
+  std::string category;
+};
+
+/// The events of one thread for one sink. Only the owning thread appends to
+/// it; the sink takes the events when writing them out.
+struct ThreadBuffer {
+  std::mutex mtx;
+  std::vector<TraceEvent> events;
+  uint64_t tid{};
+  std::string thread_name;
+  bool named = false;
+  bool exited = false;
+  std::atomic<bool> orphaned{};
+};
+
+/// All buffers of the calling thread, one per sink
+struct ThreadBuffers {
+  std::vector<std::pair<uint64_t, std::shared_ptr<ThreadBuffer>>> entries;
+
+  ~ThreadBuffers() {
+    // The sink writes out the remaining events and drops the buffer
+    for (auto &[sink_id, buffer] : entries) {
+      std::lock_guard lck(buffer->mtx);
+      buffer->exited = true;
+    }
+  }
+};
+
+ThreadBuffers &getThreadBuffers() noexcept {
+  static thread_local ThreadBuffers buffers;
+  return buffers;
+}
+
+uint64_t getNanos(std::chrono::steady_clock::time_point time) noexcept {
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      time.time_since_epoch())
+                      .count());
+}
+
+void writeEscaped(std::string &out, std::string_view str) {
+  for (char c : str) {
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        std::array<char, sizeof("\\u0000")> buf{};
+        snprintf(buf.data(), buf.size(), "\\u%04x", unsigned(c));
+        out += buf.data();
+      } else {
+        out += c;
+      }
+    }
+  }
+}
+
+/// Appends the time in microseconds, with nanosecond precision
+void writeMicros(std::string &out, uint64_t nanos) {
+  std::array<char, sizeof("18446744073709551615.000")> buf{};
+  auto len = snprintf(buf.data(), buf.size(), "%" PRIu64 ".%03" PRIu64,
+                      nanos / 1000, nanos % 1000);
+  out.append(buf.data(), size_t(len));
+}
+
+void writeThread(std::string &out, int pid, uint64_t tid) {
+  out += "\"pid\":";
+  out += std::to_string(pid);
+  out += ",\"tid\":";
+  out += std::to_string(tid);
+}
+
+void flushSink(void *context) noexcept {
+  static_cast<TraceSink *>(context)->flush();
+}
+} // namespace
+
+struct TraceSink::Impl {
+  std::mutex mtx;
+  FILE *file_handle{};
+  uint64_t id{};
+  size_t buffer_size{};
+  int pid{};
+  bool first_event = true;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+  /// The JSON of the events that are currently written
+  std::string json;
+  std::vector<TraceEvent> events;
+
+  ThreadBuffer &getThreadBuffer() noexcept;
+  void record(TraceEvent &&event) noexcept;
+  /// Returns whether the buffer's thread has exited before the drain
+  bool drainLocked(ThreadBuffer &buffer) noexcept;
+  void writeEvent(const TraceEvent &event, uint64_t tid) noexcept;
+  void writeJson() noexcept;
+};
+
+ThreadBuffer &TraceSink::Impl::getThreadBuffer() noexcept {
+  auto &entries = getThreadBuffers().entries;
+  for (const auto &[sink_id, buffer] : entries) {
+    if (sink_id == id) {
+      return *buffer;
+    }
+  }
+
+  // Drop the buffers of sinks that have been destroyed in the meantime
+  entries.erase(std::remove_if(entries.begin(), entries.end(),
+                               [](const auto &entry) {
+                                 return entry.second->orphaned.load(
+                                     std::memory_order_relaxed);
+                               }),
+                entries.end());
+
+  auto buffer = std::make_shared<ThreadBuffer>();
+  buffer->events.reserve(buffer_size);
+  buffer->tid = detail::getThreadId();
+  // Note: Empty if the thread's state is already destroyed
+  if (auto thread_field = detail::getThreadField(); thread_field.size() >= 2) {
+    buffer->thread_name = thread_field.substr(1, thread_field.size() - 2);
+  }
+
+  {
+    std::lock_guard lck(mtx);
+    buffers.push_back(buffer);
+  }
+  return *entries.emplace_back(id, std::move(buffer)).second;
+}
+
+void TraceSink::Impl::record(TraceEvent &&event) noexcept {
+  auto &buffer = getThreadBuffer();
+  bool full = false;
+  {
+    std::lock_guard lck(buffer.mtx);
+    buffer.events.push_back(std::move(event));
+    full = buffer.events.size() >= buffer_size;
+  }
+
+  if (full) {
+    std::lock_guard lck(mtx);
+    drainLocked(buffer);
+    writeJson();
+  }
+}
+
+bool TraceSink::Impl::drainLocked(ThreadBuffer &buffer) noexcept {
+  bool exited = false;
+  {
+    std::lock_guard lck(buffer.mtx);
+    std::swap(events, buffer.events);
+    exited = buffer.exited;
+    if (!exited) {
+      buffer.events.reserve(buffer_size);
+    }
+  }
+
+  if (!buffer.named && !events.empty()) {
+    buffer.named = true;
+    TraceEvent name_event{};
+    name_event.phase = 'M';
+    name_event.name = "thread_name";
+    name_event.message = buffer.thread_name;
+    writeEvent(name_event, buffer.tid);
+  }
+
+  for (const auto &event : events) {
+    writeEvent(event, buffer.tid);
+  }
+  events.clear();
+  return exited;
+}
+
+void TraceSink::Impl::writeEvent(const TraceEvent &event,
+                                 uint64_t tid) noexcept {
+  json += first_event ? "{" : ",\n{";
+  first_event = false;
+
+  json += "\"name\":\"";
+  if (event.phase == 'i') {
+    writeEscaped(json, event.message);
+  } else {
+    writeEscaped(json, event.name);
+  }
+  json += "\",\"ph\":\"";
+  json += event.phase;
+  json += "\",";
+  writeThread(json, pid, tid);
+
+  if (event.phase == 'M') {
+    json += ",\"args\":{\"name\":\"";
+    writeEscaped(json, event.message);
+    json += "\"}}";
+    return;
+  }
+
+  json += ",\"ts\":";
+  writeMicros(json, event.time_ns);
+  if (event.phase == 'X') {
+    json += ",\"dur\":";
+    writeMicros(json, event.duration_ns);
+  } else if (event.phase == 'i') {
+    json += ",\"s\":\"t\",\"cat\":\"";
+    writeEscaped(json, event.category);
+    json += "\",\"args\":{\"severity\":\"";
+    json += to_string(event.sev);
+    json += "\"}";
+  }
+  json += '}';
+}
+
+void TraceSink::Impl::writeJson() noexcept {
+  if (file_handle && !json.empty()) {
+    fwrite(json.data(), 1, json.size(), file_handle);
+  }
+  json.clear();
+}
+
+TraceSink::TraceSink(const char *file_name, size_t buffer_size) noexcept
+    : impl(new Impl()) {
+  impl->file_handle = fopen(file_name, "w");
+#ifndef ITST_DISABLE_ASSERT
+  if (!impl->file_handle) {
+    perror("Failed to open file stream");
+    ITST_BUILTIN_TRAP;
+  }
+#endif // ITST_DISABLE_ASSERT
+
+  impl->id = next_sink_id.fetch_add(1, std::memory_order_relaxed);
+  impl->buffer_size = buffer_size ? buffer_size : 1;
+  impl->pid = int(getpid());
+  impl->json = "[\n";
+  impl->writeJson();
+
+  BackgroundFlusher::add(&flushSink, this);
+}
+
+TraceSink::~TraceSink() {
+  BackgroundFlusher::remove(&flushSink, this);
+  flush();
+
+  {
+    std::lock_guard lck(impl->mtx);
+    for (auto &buffer : impl->buffers) {
+      buffer->orphaned.store(true, std::memory_order_relaxed);
+    }
+    impl->json = "\n]\n";
+    impl->writeJson();
+  }
+
+  if (impl->file_handle) {
+    fclose(impl->file_handle);
+  }
+  delete impl;
+}
+
+void TraceSink::begin(const char *name) noexcept {
+  TraceEvent event{};
+  event.phase = 'B';
+  event.name = name;
+  event.time_ns = getNanos(std::chrono::steady_clock::now());
+  impl->record(std::move(event));
+}
+
+void TraceSink::end(const char *name) noexcept {
+  TraceEvent event{};
+  event.phase = 'E';
+  event.name = name;
+  event.time_ns = getNanos(std::chrono::steady_clock::now());
+  impl->record(std::move(event));
+}
+
+void TraceSink::complete(const char *name,
+                         std::chrono::steady_clock::time_point start,
+                         std::chrono::steady_clock::time_point end) noexcept {
+  TraceEvent event{};
+  event.phase = 'X';
+  event.name = name;
+  event.time_ns = getNanos(start);
+  event.duration_ns = getNanos(end) - event.time_ns;
+  impl->record(std::move(event));
+}
+
+void TraceSink::instant(std::string_view name, std::string_view category,
+                        LogSeverity sev) noexcept {
+  TraceEvent event{};
+  event.phase = 'i';
+  event.sev = sev;
+  event.time_ns = getNanos(std::chrono::steady_clock::now());
+  event.message = name;
+  event.category = category;
+  impl->record(std::move(event));
+}
+
+void TraceSink::flush() noexcept {
+  std::lock_guard lck(impl->mtx);
+  // The threads that have exited cannot add any events anymore, so drop
+  // their buffers after the last drain
+  auto &buffers = impl->buffers;
+  buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+                               [impl = impl](const auto &buffer) {
+                                 return impl->drainLocked(*buffer);
+                               }),
+                buffers.end());
+  impl->writeJson();
+
+  if (impl->file_handle) {
+    fflush(impl->file_handle);
+  }
+}
+
+void TraceSink::setGlobal(TraceSink *sink) noexcept {
+  global_sink.store(sink, std::memory_order_release);
+}
+
+TraceSink *TraceSink::getGlobal() noexcept {
+  return global_sink.load(std::memory_order_acquire);
+}
+
+void TraceLogger::commitRecord(LogSeverity msg_sev) const noexcept {
+  auto record = RecordBuffer::view();
+  // Strip the header; the timeline shows the time, severity and category
+  // already
+  if (auto pos = record.find("]: "); pos != std::string_view::npos) {
+    record.remove_prefix(pos + 3);
+  }
+  if (!record.empty() && record.back() == '\n') {
+    record.remove_suffix(1);
+  }
+
+  sink->instant(record, class_name, msg_sev);
+  RecordBuffer::reset();
+
+  if (shouldFlush(msg_sev)) {
+    sink->flush();
+  }
+}
+} // namespace itst
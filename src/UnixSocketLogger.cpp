@@ -0,0 +1,185 @@
+#include "itst/UnixSocketLogger.h"
+#include "itst/Buffering.h"
+#include "itst/Core.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace itst {
+namespace {
+void flushSink(void *context) noexcept {
+  static_cast<UnixSocketSink *>(context)->flush();
+}
+} // namespace
+
+struct UnixSocketSink::Impl {
+  std::mutex mtx;
+  int fd = -1;
+  int socket_type{};
+  sockaddr_un addr{};
+  size_t batch_size{};
+
+  /// The pending records, concatenated
+  std::vector<char> data;
+  /// The end-offsets of the pending records in data
+  std::vector<size_t> ends;
+
+  std::vector<iovec> iovs;
+#ifdef __linux__
+  std::vector<mmsghdr> msgs;
+#endif
+
+  std::atomic<size_t> num_dropped{};
+
+  bool connect() noexcept;
+  void sendBatch() noexcept;
+  size_t sendMessages(size_t first, size_t count) noexcept;
+};
+
+bool UnixSocketSink::Impl::connect() noexcept {
+  if (fd >= 0) {
+    return true;
+  }
+
+  fd = socket(AF_UNIX, socket_type | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (fd < 0) {
+    return false;
+  }
+
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+  if (::connect(fd, (const sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    fd = -1;
+    return false;
+  }
+  return true;
+}
+
+size_t UnixSocketSink::Impl::sendMessages(size_t first, size_t count) noexcept {
+#ifdef __linux__
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  auto ret = sendmmsg(fd, msgs.data() + first, count,
+                      MSG_DONTWAIT | MSG_NOSIGNAL);
+  return ret < 0 ? 0 : size_t(ret);
+#else
+  size_t sent = 0;
+  for (; sent < count; ++sent) {
+    const auto &iov = iovs[first + sent];
+    if (::send(fd, iov.iov_base, iov.iov_len, MSG_DONTWAIT | MSG_NOSIGNAL) <
+        0) {
+      break;
+    }
+  }
+  return sent;
+#endif
+}
+
+void UnixSocketSink::Impl::sendBatch() noexcept {
+  auto num_records = ends.size();
+  if (!num_records) {
+    return;
+  }
+
+  size_t sent = 0;
+  if (connect()) {
+    size_t begin = 0;
+    for (size_t i = 0; i != num_records; ++i) {
+      iovs[i] = {&data[begin], ends[i] - begin};
+      begin = ends[i];
+    }
+
+    while (sent < num_records) {
+      errno = 0;
+      sent += sendMessages(sent, num_records - sent);
+      if (sent == num_records || errno == 0 || errno == EINTR) {
+        continue;
+      }
+      if (errno == EMSGSIZE) {
+        // This record can never be sent, so skip it
+        ++sent;
+        num_dropped.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS) {
+        // The collector has gone away. Reconnect with the next batch
+        close(fd);
+        fd = -1;
+      }
+      break;
+    }
+  }
+
+  num_dropped.fetch_add(num_records - sent, std::memory_order_relaxed);
+  data.clear();
+  ends.clear();
+}
+
+UnixSocketSink::UnixSocketSink(const char *socket_path, SocketType type,
+                               size_t batch_size) noexcept
+    : impl(new Impl()) {
+  impl->socket_type =
+      type == SocketType::Datagram ? SOCK_DGRAM : SOCK_SEQPACKET;
+  impl->batch_size = batch_size ? batch_size : 1;
+
+  impl->addr.sun_family = AF_UNIX;
+  auto path_len = strlen(socket_path);
+#ifndef ITST_DISABLE_ASSERT
+  if (path_len >= sizeof(impl->addr.sun_path)) {
+    fputs("The unix socket path is too long\n", stderr);
+    ITST_BUILTIN_TRAP;
+  }
+#endif // ITST_DISABLE_ASSERT
+  memcpy(impl->addr.sun_path, socket_path,
+         std::min(path_len, sizeof(impl->addr.sun_path) - 1));
+
+  impl->ends.reserve(impl->batch_size);
+  impl->iovs.resize(impl->batch_size);
+#ifdef __linux__
+  impl->msgs.resize(impl->batch_size);
+  for (size_t i = 0; i != impl->batch_size; ++i) {
+    impl->msgs[i].msg_hdr.msg_iov = &impl->iovs[i];
+    impl->msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+#endif
+
+  // Note: It is fine, if the collector is not up yet
+  impl->connect();
+
+  BackgroundFlusher::add(&flushSink, this);
+}
+
+UnixSocketSink::~UnixSocketSink() {
+  BackgroundFlusher::remove(&flushSink, this);
+  flush();
+  if (impl->fd >= 0) {
+    close(impl->fd);
+  }
+  delete impl;
+}
+
+void UnixSocketSink::send(std::string_view record, bool send_now) noexcept {
+  std::lock_guard lck(impl->mtx);
+  impl->data.insert(impl->data.end(), record.begin(), record.end());
+  impl->ends.push_back(impl->data.size());
+
+  if (send_now || impl->ends.size() >= impl->batch_size) {
+    impl->sendBatch();
+  }
+}
+
+void UnixSocketSink::flush() noexcept {
+  std::lock_guard lck(impl->mtx);
+  impl->sendBatch();
+}
+
+size_t UnixSocketSink::getNumDropped() const noexcept {
+  return impl->num_dropped.load(std::memory_order_relaxed);
+}
+} // namespace itst
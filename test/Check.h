@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+/// Aborts the test with the location of the check, if COND does not hold
+#define ITST_CHECK(COND)                                                       \
+  do {                                                                         \
+    if (!(COND)) {                                                             \
+      fprintf(stderr, "%s:%d: Check failed: %s\n", __FILE__, __LINE__, #COND); \
+      std::exit(1);                                                            \
+    }                                                                          \
+  } while (false)
@@ -0,0 +1,173 @@
+#include "Check.h"
+
+#include "itst/CompressedFileLogger.h"
+
+#if defined(ITST_HAS_ZSTD)
+#include <zstd.h>
+#elif defined(ITST_HAS_LZ4)
+#include <lz4frame.h>
+#elif defined(ITST_HAS_ZLIB)
+#include <zlib.h>
+#endif
+
+#include <unistd.h>
+
+#include <array>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Logs from several threads through a CompressedFileLogger with small blocks,
+// decompresses the file with the codec of the sink and checks that it holds
+// every record exactly once and in the order of its thread.
+
+using namespace itst;
+
+namespace {
+constexpr size_t NumThreads = 4;
+constexpr size_t NumRecords = 2000;
+/// Small blocks, such that the file consists of many frames
+constexpr size_t BlockSize = 4096;
+
+std::string readFile(const std::string &path) {
+  FILE *file = fopen(path.c_str(), "rb");
+  ITST_CHECK(file);
+  std::string ret;
+  std::array<char, 4096> buf{};
+  size_t len = 0;
+  while ((len = fread(buf.data(), 1, buf.size(), file)) != 0) {
+    ret.append(buf.data(), len);
+  }
+  fclose(file);
+  return ret;
+}
+
+/// Decompresses the concatenated frames
+std::string decompress(std::string_view data) {
+  std::string ret;
+  std::array<char, 1 << 16> buf{};
+#if defined(ITST_HAS_ZSTD)
+  auto *ctx = ZSTD_createDCtx();
+  ITST_CHECK(ctx);
+  ZSTD_inBuffer in{data.data(), data.size(), 0};
+  bool full = false;
+  do {
+    ZSTD_outBuffer out{buf.data(), buf.size(), 0};
+    ITST_CHECK(!ZSTD_isError(ZSTD_decompressStream(ctx, &out, &in)));
+    ret.append(buf.data(), out.pos);
+    full = out.pos == out.size;
+  } while (in.pos < in.size || full);
+  ZSTD_freeDCtx(ctx);
+#elif defined(ITST_HAS_LZ4)
+  LZ4F_dctx *ctx{};
+  ITST_CHECK(!LZ4F_isError(
+      LZ4F_createDecompressionContext(&ctx, LZ4F_VERSION)));
+  bool full = false;
+  do {
+    auto dst_size = buf.size();
+    auto src_size = data.size();
+    ITST_CHECK(!LZ4F_isError(LZ4F_decompress(ctx, buf.data(), &dst_size,
+                                             data.data(), &src_size,
+                                             nullptr)));
+    ret.append(buf.data(), dst_size);
+    data.remove_prefix(src_size);
+    full = dst_size == buf.size();
+  } while (!data.empty() || full);
+  LZ4F_freeDecompressionContext(ctx);
+#elif defined(ITST_HAS_ZLIB)
+  z_stream stream{};
+  // Note: 15 + 32 window-bits detect the gzip header
+  ITST_CHECK(inflateInit2(&stream, 15 + 32) == Z_OK);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+  stream.avail_in = uInt(data.size());
+  while (true) {
+    stream.next_out = reinterpret_cast<Bytef *>(buf.data());
+    stream.avail_out = uInt(buf.size());
+    auto ret_code = inflate(&stream, Z_NO_FLUSH);
+    ret.append(buf.data(), buf.size() - stream.avail_out);
+    if (ret_code == Z_STREAM_END) {
+      if (!stream.avail_in) {
+        break;
+      }
+      // The next gzip member
+      ITST_CHECK(inflateReset(&stream) == Z_OK);
+      continue;
+    }
+    ITST_CHECK(ret_code == Z_OK);
+    // Truncated member
+    ITST_CHECK(stream.avail_in || !stream.avail_out);
+  }
+  inflateEnd(&stream);
+#endif
+  return ret;
+}
+
+std::string getPayload(size_t thread, size_t i) {
+  return "thread " + std::to_string(thread) + " record " + std::to_string(i);
+}
+} // namespace
+
+int main() {
+  char dir[] = "/tmp/itst-compressed-test.XXXXXX";
+  ITST_CHECK(mkdtemp(dir));
+  auto path = std::string(dir) + "/compressed.log";
+
+  {
+    CompressedFileSink sink(path.c_str(), BlockSize);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t != NumThreads; ++t) {
+      threads.emplace_back([&sink, t] {
+        CompressedFileLogger logger(sink, "CompressedFileLoggerTest",
+                                    LogSeverity::Info);
+        for (size_t i = 0; i != NumRecords; ++i) {
+          logger.logInfo(getPayload(t, i));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    sink.flush();
+    ITST_CHECK(sink.getNumDroppedBlocks() == 0);
+  }
+
+  auto content = decompress(readFile(path));
+
+  // The index of the next record of each thread
+  std::array<size_t, NumThreads> next{};
+  std::string_view rest = content;
+  constexpr std::string_view Delim = "][INFO][CompressedFileLoggerTest]: ";
+  while (!rest.empty()) {
+    auto end = rest.find('\n');
+    ITST_CHECK(end != std::string_view::npos);
+    auto line = rest.substr(0, end);
+    rest.remove_prefix(end + 1);
+
+    auto delim = line.find(Delim);
+    ITST_CHECK(line.front() == '[' && delim != std::string_view::npos);
+    auto payload = line.substr(delim + Delim.size());
+
+    bool found = false;
+    for (size_t t = 0; t != NumThreads && !found; ++t) {
+      if (next[t] != NumRecords && payload == getPayload(t, next[t])) {
+        ++next[t];
+        found = true;
+      }
+    }
+    if (!found) {
+      fprintf(stderr, "Unexpected record: %.*s\n", int(line.size()),
+              line.data());
+      return 1;
+    }
+  }
+  for (auto num : next) {
+    ITST_CHECK(num == NumRecords);
+  }
+
+  unlink(path.c_str());
+  rmdir(dir);
+  return 0;
+}
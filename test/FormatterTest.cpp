@@ -0,0 +1,81 @@
+#include "Check.h"
+
+#include "itst/Logger.hpp"
+#include "itst/StringLogger.h"
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <version>
+
+// Logs a type with both a std::formatter and an operator<< in a C++20 build,
+// and checks that the logger prints it through the formatter, also if the
+// output is longer than the stack buffer of the formatting.
+
+#ifdef __cpp_lib_format
+#include <format>
+
+namespace {
+struct Point {
+  int x{};
+  int y{};
+  /// Repeats the point, to exceed the buffer of the formatting
+  size_t repeat = 1;
+};
+
+/// Never called, as the logger prefers the formatter
+[[maybe_unused]] std::ostream &operator<<(std::ostream &os,
+                                          const Point & /*point*/) {
+  return os << "ostream";
+}
+} // namespace
+
+template <> struct std::formatter<Point> {
+  constexpr auto parse(std::format_parse_context &ctx) { return ctx.begin(); }
+
+  auto format(const Point &point, std::format_context &ctx) const {
+    auto out = ctx.out();
+    for (size_t i = 0; i != point.repeat; ++i) {
+      out = std::format_to(out, "({}, {})", point.x, point.y);
+    }
+    return out;
+  }
+};
+
+using namespace itst;
+
+namespace {
+/// Whether the only record of the logger has the content
+bool hasContent(const StringLogger &logger, const std::string &content) {
+  auto record = logger.str();
+  auto suffix = "][INFO][FormatterTest]: " + content + '\n';
+  return record.size() > suffix.size() &&
+         record.substr(record.size() - suffix.size()) == suffix &&
+         record.find('\n') == record.size() - 1;
+}
+} // namespace
+
+int main() {
+  {
+    StringLogger logger("FormatterTest", LogSeverity::Info);
+    logger.logInfo("point ", Point{1, -2});
+    ITST_CHECK(hasContent(logger, "point (1, -2)"));
+  }
+  {
+    StringLogger logger("FormatterTest", LogSeverity::Info);
+    logger.logInfo(Point{123, 456, 100});
+    std::string expected;
+    for (size_t i = 0; i != 100; ++i) {
+      expected += "(123, 456)";
+    }
+    ITST_CHECK(hasContent(logger, expected));
+  }
+  return 0;
+}
+#else
+int main() {
+  fprintf(stderr, "Skipped: The standard library does not provide <format>\n");
+  // See SKIP_RETURN_CODE in test/CMakeLists.txt
+  return 77;
+}
+#endif // __cpp_lib_format
@@ -0,0 +1,140 @@
+#include "Check.h"
+
+#include "itst/AppendFileLogger.h"
+#include "itst/Context.h"
+#include "itst/FileLogger.h"
+#include "itst/Macros.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+
+// Checks the guarantee of ITST_NO_ALLOC: Once the loggers are constructed and
+// the thread's buffers are preallocated, logging must not allocate. malloc and
+// operator new are interposed to count the allocations of the logging thread
+// (glibc only, see __libc_malloc).
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t num, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+}
+
+namespace {
+std::atomic<size_t> num_allocs{0};
+/// Only the allocations of the logging thread count
+thread_local bool counting = false;
+
+void countAlloc() noexcept {
+  if (counting) {
+    num_allocs.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+/// Counts the allocations during its lifetime
+class AllocationCounter {
+public:
+  AllocationCounter() noexcept { counting = true; }
+  ~AllocationCounter() { counting = false; }
+
+  AllocationCounter(const AllocationCounter &) = delete;
+  AllocationCounter &operator=(const AllocationCounter &) = delete;
+};
+} // namespace
+
+extern "C" {
+void *malloc(size_t size) {
+  countAlloc();
+  return __libc_malloc(size);
+}
+void *calloc(size_t num, size_t size) {
+  countAlloc();
+  return __libc_calloc(num, size);
+}
+void *realloc(void *ptr, size_t size) {
+  countAlloc();
+  return __libc_realloc(ptr, size);
+}
+void free(void *ptr) { __libc_free(ptr); }
+}
+
+void *operator new(size_t size) {
+  countAlloc();
+  if (auto *ret = __libc_malloc(size ? size : 1)) {
+    return ret;
+  }
+  throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { __libc_free(ptr); }
+void operator delete[](void *ptr) noexcept { __libc_free(ptr); }
+void operator delete(void *ptr, size_t /*size*/) noexcept { __libc_free(ptr); }
+void operator delete[](void *ptr, size_t /*size*/) noexcept {
+  __libc_free(ptr);
+}
+
+using namespace itst;
+
+namespace {
+/// Logs one record of each kind of statement
+template <typename LoggerT> void logAll(const LoggerT &logger) {
+  logger.logInfo("log ", 42, ' ', -1.5, ' ', std::string_view("view"), ' ',
+                 true);
+  logger.logf(ITST_FMT("logf {} {}"), LogSeverity::Info, 42, "str");
+  ITST_LOG(Info, "ITST_LOG ", 42);
+  ITST_LOGF(Info, "ITST_LOGF {}", 42);
+  logger.stream(LogSeverity::Info) << "stream " << 42;
+  // Filtered by the severity
+  logger.logDebug("filtered");
+  logger.flush();
+}
+
+size_t countLines(const std::string &path) {
+  FILE *file = fopen(path.c_str(), "r");
+  ITST_CHECK(file);
+  size_t ret = 0;
+  for (int c = 0; (c = fgetc(file)) != EOF;) {
+    ret += c == '\n';
+  }
+  fclose(file);
+  return ret;
+}
+} // namespace
+
+int main() {
+  char dir[] = "/tmp/itst-no-alloc-test.XXXXXX";
+  ITST_CHECK(mkdtemp(dir));
+  auto file_path = std::string(dir) + "/file.log";
+  auto append_path = std::string(dir) + "/append.log";
+
+  {
+    FileLogger file_logger(file_path, "NoAllocTest", LogSeverity::Info);
+    AppendFileSink sink(append_path.c_str());
+    AppendFileLogger append_logger(sink, "NoAllocTest", LogSeverity::Info);
+    preallocateThreadBuffers();
+
+    {
+      AllocationCounter counter;
+      logAll(file_logger);
+      logAll(append_logger);
+    }
+    if (num_allocs != 0) {
+      fprintf(stderr, "Logging allocated %zu times\n", num_allocs.load());
+      return 1;
+    }
+  }
+
+  ITST_CHECK(countLines(file_path) == 5);
+  ITST_CHECK(countLines(append_path) == 5);
+
+  unlink(file_path.c_str());
+  unlink(append_path.c_str());
+  rmdir(dir);
+  return 0;
+}
@@ -0,0 +1,232 @@
+#include "Check.h"
+
+#include "itst/SharedMemoryLogger.h"
+
+#include "SharedMemoryRingLayout.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Checks the SharedMemoryRing: the sequence numbers of concurrent writers,
+// records that wrap around the end of the ring, the drops of a full ring and
+// the records that a crashed producer has reserved but never committed. The
+// latter are faked through the ring's layout, see SharedMemoryRingLayout.h.
+
+using namespace itst;
+
+namespace {
+using Records = std::vector<std::pair<uint64_t, std::string>>;
+
+/// A unique name per test case, such that parallel runs do not collide
+std::string getRingName(std::string_view test) {
+  return "/itst-ring-test-" + std::to_string(getpid()) + '-' +
+         std::string(test);
+}
+
+void appendRecord(void *context, uint64_t seq,
+                  std::string_view record) noexcept {
+  static_cast<Records *>(context)->emplace_back(seq, record);
+}
+
+Records readAll(SharedMemoryRing &ring) {
+  Records ret;
+  (void)ring.read(appendRecord, &ret);
+  return ret;
+}
+
+std::string getPayload(size_t thread, size_t i) {
+  return "thread " + std::to_string(thread) + " record " + std::to_string(i);
+}
+
+/// Maps the ring's memory like a producer does, to fake crashed producers
+class RingMapping {
+public:
+  explicit RingMapping(const std::string &name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    ITST_CHECK(fd >= 0);
+    struct stat info {};
+    ITST_CHECK(fstat(fd, &info) == 0);
+    size = size_t(info.st_size);
+    auto *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    ITST_CHECK(mem != MAP_FAILED);
+    header = static_cast<detail::RingHeader *>(mem);
+  }
+  ~RingMapping() { munmap(header, size); }
+
+  RingMapping(const RingMapping &) = delete;
+  RingMapping &operator=(const RingMapping &) = delete;
+
+  /// Reserves a record with a payload of len bytes, like SharedMemoryRing::
+  /// write() does. publish decides whether the producer crashes after or
+  /// before it has published the record's header.
+  void reserve(uint32_t len, bool publish) const {
+    auto rec_size = detail::alignRecord(sizeof(detail::RecordHeader) + len);
+    auto pos = header->write_pos.fetch_add(rec_size);
+    // Note: The ring is empty, so the record does not wrap around
+    ITST_CHECK(pos + rec_size <= header->capacity);
+    (void)header->next_seq.fetch_add(1);
+    if (publish) {
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+      auto *rec = reinterpret_cast<detail::RecordHeader *>(
+          reinterpret_cast<char *>(header) + sizeof(detail::RingHeader) + pos);
+      rec->state_len.store(detail::Reserved | len);
+    }
+  }
+
+private:
+  detail::RingHeader *header{};
+  size_t size{};
+};
+
+void testConcurrentWriters() {
+  constexpr size_t NumThreads = 4;
+  constexpr size_t NumRecords = 5000;
+  auto name = getRingName("concurrent");
+  // Large enough for all records, such that none is dropped
+  SharedMemoryRing ring(name.c_str(), size_t(1) << 20);
+  ITST_CHECK(ring.isValid());
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t != NumThreads; ++t) {
+    threads.emplace_back([&ring, t] {
+      for (size_t i = 0; i != NumRecords; ++i) {
+        ITST_CHECK(ring.write(getPayload(t, i)));
+      }
+    });
+  }
+  // Reads concurrently
+  Records records;
+  while (records.size() != NumThreads * NumRecords) {
+    if (!ring.read(appendRecord, &records)) {
+      std::this_thread::yield();
+    }
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ITST_CHECK(ring.getNumDropped() == 0);
+  ITST_CHECK(readAll(ring).empty());
+
+  // The records of each thread are in order
+  std::array<size_t, NumThreads> next{};
+  for (const auto &[seq, record] : records) {
+    bool found = false;
+    for (size_t t = 0; t != NumThreads && !found; ++t) {
+      if (next[t] != NumRecords && record == getPayload(t, next[t])) {
+        ++next[t];
+        found = true;
+      }
+    }
+    ITST_CHECK(found);
+  }
+
+  // The sequence numbers are consecutive
+  std::sort(records.begin(), records.end());
+  for (size_t i = 0; i != records.size(); ++i) {
+    ITST_CHECK(records[i].first == i);
+  }
+  SharedMemoryRing::remove(name.c_str());
+}
+
+void testWrapAround() {
+  auto name = getRingName("wrap");
+  SharedMemoryRing ring(name.c_str(), 0);
+  ITST_CHECK(ring.getCapacity() == detail::MinCapacity);
+
+  // Different lengths, such that the records end at different positions and
+  // padding is needed to wrap around
+  constexpr size_t NumRecords = 2000;
+  Records expected;
+  for (size_t i = 0; i != NumRecords; ++i) {
+    auto record =
+        std::string(i * 37 % 900, char('a' + i % 26)) + std::to_string(i);
+    ITST_CHECK(ring.write(record));
+    expected.emplace_back(i, std::move(record));
+    // Reads after every third record only, such that the ring holds a
+    // backlog, which wraps around
+    if (i % 3 == 2) {
+      ITST_CHECK(readAll(ring) == expected);
+      expected.clear();
+    }
+  }
+  ITST_CHECK(ring.getNumDropped() == 0);
+  SharedMemoryRing::remove(name.c_str());
+}
+
+void testFullRing() {
+  auto name = getRingName("full");
+  SharedMemoryRing ring(name.c_str(), 0);
+  std::string record(100, 'x');
+
+  size_t num_written = 0;
+  while (ring.write(record)) {
+    ++num_written;
+  }
+  ITST_CHECK(num_written > 0);
+  // Including the write that has failed above
+  constexpr size_t NumDropped = 10;
+  for (size_t i = 1; i != NumDropped; ++i) {
+    ITST_CHECK(!ring.write(record));
+  }
+  ITST_CHECK(ring.getNumDropped() == NumDropped);
+
+  auto records = readAll(ring);
+  ITST_CHECK(records.size() == num_written);
+  for (size_t i = 0; i != records.size(); ++i) {
+    ITST_CHECK(records[i].first == i && records[i].second == record);
+  }
+
+  // The drops show up as a gap in the sequence numbers
+  ITST_CHECK(ring.write(record));
+  records = readAll(ring);
+  ITST_CHECK(records.size() == 1 &&
+             records[0].first == num_written + NumDropped);
+  SharedMemoryRing::remove(name.c_str());
+}
+
+void testStalledRecord(bool publish) {
+  auto name = getRingName(publish ? "reserved" : "unpublished");
+  SharedMemoryRing ring(name.c_str(), 0);
+  RingMapping mapping(name);
+
+  mapping.reserve(42, publish);
+  ITST_CHECK(ring.write("after"));
+
+  // Waits for the producer to commit the record
+  ITST_CHECK(readAll(ring).empty());
+  ITST_CHECK(ring.getNumDropped() == 0);
+
+  std::this_thread::sleep_for(detail::StallTimeout +
+                              std::chrono::milliseconds(100));
+  auto records = readAll(ring);
+  ITST_CHECK(records.size() == 1);
+  ITST_CHECK(records[0].first == 1 && records[0].second == "after");
+  ITST_CHECK(ring.getNumDropped() == 1);
+
+  // The skipped record does not affect the following ones
+  ITST_CHECK(ring.write("next"));
+  records = readAll(ring);
+  ITST_CHECK(records.size() == 1 && records[0].second == "next");
+  SharedMemoryRing::remove(name.c_str());
+}
+} // namespace
+
+int main() {
+  testConcurrentWriters();
+  testWrapAround();
+  testFullRing();
+  testStalledRecord(/*publish=*/true);
+  testStalledRecord(/*publish=*/false);
+  return 0;
+}
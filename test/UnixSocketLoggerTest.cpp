@@ -0,0 +1,171 @@
+#include "Check.h"
+
+#include "itst/UnixSocketLogger.h"
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Logs through a UnixSocketLogger into a datagram socket that is bound by the
+// test itself, and checks that each record arrives intact and in order, also if
+// it is larger than the batching buffers or the socket can take.
+
+using namespace itst;
+
+namespace {
+constexpr size_t BatchSize = 4;
+constexpr size_t NumRecords = 200;
+#ifdef ITST_NO_ALLOC
+// The records are truncated to the fixed-size RecordBuffer
+constexpr size_t LargePayloadSize = 8000;
+#else
+constexpr size_t LargePayloadSize = 100000;
+#endif
+
+/// Receives the datagrams of the socket until it is stopped
+class Receiver {
+public:
+  explicit Receiver(const std::string &path) {
+    fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    ITST_CHECK(fd >= 0);
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    ITST_CHECK(path.size() < sizeof(addr.sun_path));
+    memcpy(addr.sun_path, path.c_str(), path.size());
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+    ITST_CHECK(bind(fd, (const sockaddr *)&addr, sizeof(addr)) == 0);
+
+    // Wake up regularly to check whether the receiver has been stopped
+    timeval timeout{0, 100 * 1000};
+    ITST_CHECK(setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                          sizeof(timeout)) == 0);
+
+    thread = std::thread([this] { run(); });
+  }
+
+  ~Receiver() {
+    stopped = true;
+    thread.join();
+    close(fd);
+  }
+
+  Receiver(const Receiver &) = delete;
+  Receiver &operator=(const Receiver &) = delete;
+
+  /// Waits until num datagrams have been received in total
+  bool waitFor(size_t num) {
+    std::unique_lock lck(mtx);
+    return cv.wait_for(lck, std::chrono::seconds(10),
+                       [&] { return records.size() >= num; });
+  }
+
+  std::vector<std::string> getRecords() {
+    std::lock_guard lck(mtx);
+    return records;
+  }
+
+private:
+  void run() {
+    std::vector<char> buf(1 << 21);
+    while (!stopped) {
+      auto len = recv(fd, buf.data(), buf.size(), 0);
+      if (len < 0) {
+        continue;
+      }
+      std::lock_guard lck(mtx);
+      records.emplace_back(buf.data(), size_t(len));
+      cv.notify_all();
+    }
+  }
+
+  int fd = -1;
+  std::thread thread;
+  std::atomic<bool> stopped{false};
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::vector<std::string> records;
+};
+
+std::string getPayload(size_t i) {
+  auto ret = "record " + std::to_string(i);
+  if (i % 25 == 7) {
+    ret += ' ';
+    ret.append(LargePayloadSize, char('a' + i % 26));
+  }
+  return ret;
+}
+
+/// Whether the datagram is exactly one record of the logger with the payload
+bool isRecord(const std::string &record, const std::string &payload) {
+  std::string suffix = "][INFO][UnixSocketLoggerTest]: " + payload + '\n';
+  return record.size() > suffix.size() && record.front() == '[' &&
+         record.compare(record.size() - suffix.size(), suffix.size(),
+                        suffix) == 0 &&
+         record.find('\n') == record.size() - 1;
+}
+} // namespace
+
+int main() {
+  char dir[] = "/tmp/itst-socket-test.XXXXXX";
+  ITST_CHECK(mkdtemp(dir));
+  auto path = std::string(dir) + "/collector.sock";
+
+  std::vector<std::string> expected;
+  size_t num_dropped = 0;
+  {
+    Receiver receiver(path);
+    UnixSocketSink sink(path.c_str(), UnixSocketSink::SocketType::Datagram,
+                        BatchSize);
+    UnixSocketLogger logger(sink, "UnixSocketLoggerTest", LogSeverity::Info);
+
+    for (size_t i = 0; i != NumRecords; ++i) {
+      expected.push_back(getPayload(i));
+      logger.logInfo(expected.back());
+
+      // Let the receiver catch up, as the sink drops the records instead of
+      // blocking once the socket's queue is full
+      if (expected.size() % (2 * BatchSize) == 0) {
+        sink.flush();
+        ITST_CHECK(receiver.waitFor(expected.size()));
+      }
+    }
+
+#ifndef ITST_NO_ALLOC
+    // Larger than the socket's send buffer, i.e., it can never be sent
+    logger.logInfo(std::string(size_t(4) << 20, 'x'));
+    num_dropped = 1;
+#endif
+    expected.push_back("after the oversized record");
+    logger.logInfo(expected.back());
+    sink.flush();
+
+    ITST_CHECK(receiver.waitFor(expected.size()));
+    ITST_CHECK(sink.getNumDropped() == num_dropped);
+
+    auto records = receiver.getRecords();
+    ITST_CHECK(records.size() == expected.size());
+    for (size_t i = 0; i != records.size(); ++i) {
+      if (!isRecord(records[i], expected[i])) {
+        fprintf(stderr, "Record %zu does not match: %.100s\n", i,
+                records[i].c_str());
+        return 1;
+      }
+    }
+  }
+
+  unlink(path.c_str());
+  rmdir(dir);
+  return 0;
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "itst/LogSeverity.h"
+#include "itst/LoggerBase.h"
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Parsing of the record headers written by LoggerBase::printHeader:
+//   [YYYY-MM-DD hh:mm:ss.ffffff][SEVERITY][category][field]...: content
+// where the optional fields are the thread and the diagnostic context.
+
+namespace itst::tools {
+
+/// A timestamp encoded as one integer, such that the order of the encoded
+/// values matches the order of the timestamps. The encoding is not a duration;
+/// use it only for comparisons.
+using TimeKey = int64_t;
+
+static constexpr size_t TimestampLength = LoggerBase::getTimestepLength();
+
+/// The offset of the severity within a record.
+static constexpr size_t SeverityOffset = TimestampLength + 3;
+
+struct RecordHeader {
+  TimeKey time{};
+  LogSeverity severity{};
+  std::string_view category;
+  /// The optional fields after the category, e.g. "[4711][req=42]"
+  std::string_view fields;
+  /// The length of the header including the trailing "]: "
+  size_t length{};
+};
+
+[[nodiscard]] constexpr TimeKey makeTimeKey(int year, int month, int day,
+                                            int hour, int minute, int second,
+                                            int micros) noexcept {
+  TimeKey ret = (TimeKey(year) * 16 + month) * 32 + day;
+  ret = ((ret * 24 + hour) * 60 + minute) * 60 + second;
+  return ret * 1'000'000 + micros;
+}
+
+namespace detail {
+/// Checks the fixed layout "YYYY-MM-DD hh:mm:ss.ffffff"
+[[nodiscard]] inline bool hasTimestampLayout(const char *ts) noexcept {
+#if defined(__SSE2__)
+  // Check the bytes [0, 16) and [10, 26) at once. Separator positions must
+  // match exactly, all other positions must be digits
+  static constexpr char Pattern[] = "0000-00-00 00:00:00.000000";
+  auto check = [](const char *str, const char *pattern) {
+    auto val = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str));
+    auto pat = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pattern));
+    auto is_digit_pos = _mm_cmpeq_epi8(pat, _mm_set1_epi8('0'));
+    auto digit = _mm_sub_epi8(val, _mm_set1_epi8('0'));
+    auto is_digit =
+        _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    auto is_sep = _mm_cmpeq_epi8(val, pat);
+    auto valid = _mm_or_si128(_mm_and_si128(is_digit_pos, is_digit),
+                              _mm_andnot_si128(is_digit_pos, is_sep));
+    return _mm_movemask_epi8(valid) == 0xFFFF;
+  };
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  return check(ts, Pattern) && check(ts + 10, Pattern + 10);
+#else
+  static constexpr std::string_view Pattern = "0000-00-00 00:00:00.000000";
+  for (size_t i = 0; i != Pattern.size(); ++i) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    auto chr = ts[i];
+    if (Pattern[i] == '0' ? unsigned(chr - '0') > 9 : chr != Pattern[i]) {
+      return false;
+    }
+  }
+  return true;
+#endif
+}
+
+[[nodiscard]] inline int digits(const char *str, size_t count) noexcept {
+  int ret = 0;
+  for (size_t i = 0; i != count; ++i) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    ret = ret * 10 + (str[i] - '0');
+  }
+  return ret;
+}
+} // namespace detail
+
+/// Parses a timestamp in the fixed format "YYYY-MM-DD hh:mm:ss.ffffff". The
+/// string must provide at least TimestampLength readable bytes.
+[[nodiscard]] inline std::optional<TimeKey>
+parseTimestamp(const char *ts) noexcept {
+  if (!detail::hasTimestampLayout(ts)) {
+    return std::nullopt;
+  }
+
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  return makeTimeKey(detail::digits(ts, 4), detail::digits(ts + 5, 2),
+                     detail::digits(ts + 8, 2), detail::digits(ts + 11, 2),
+                     detail::digits(ts + 14, 2), detail::digits(ts + 17, 2),
+                     detail::digits(ts + 20, 6));
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+/// Parses a possibly abbreviated timestamp, e.g. "2022-11-02" or
+/// "2022-11-02 15:10". The missing parts are taken as zero.
+[[nodiscard]] inline std::optional<TimeKey>
+parseTimestampPrefix(std::string_view str) noexcept {
+  char buf[TimestampLength + 16] = "0000-01-01 00:00:00.000000";
+  if (str.size() > TimestampLength) {
+    return std::nullopt;
+  }
+  memcpy(buf, str.data(), str.size());
+  return parseTimestamp(buf);
+}
+
+/// Parses the header of the record that starts at the beginning of line.
+/// Returns std::nullopt, if the line is not the first line of a record.
+[[nodiscard]] inline std::optional<RecordHeader>
+parseHeader(std::string_view line) noexcept {
+  // The shortest header has an empty category and a 4 letter severity
+  static constexpr size_t MinHeaderLength = SeverityOffset + 4 + 5;
+
+  // Note: We need 16 bytes readable from offset 11 for the vectorized check
+  if (line.size() < MinHeaderLength || line[0] != '[' ||
+      line[TimestampLength + 1] != ']' || line[TimestampLength + 2] != '[') {
+    return std::nullopt;
+  }
+
+  RecordHeader ret{};
+  auto time = parseTimestamp(&line[1]);
+  if (!time) {
+    return std::nullopt;
+  }
+  ret.time = *time;
+
+  auto sev_end = line.find(']', SeverityOffset);
+  if (sev_end == std::string_view::npos || sev_end + 1 >= line.size() ||
+      line[sev_end + 1] != '[') {
+    return std::nullopt;
+  }
+  auto sev =
+      from_string(line.substr(SeverityOffset, sev_end - SeverityOffset));
+  if (!sev) {
+    return std::nullopt;
+  }
+  ret.severity = *sev;
+
+  auto cat_begin = sev_end + 2;
+  auto header_end = line.find("]: ", cat_begin);
+  if (header_end == std::string_view::npos) {
+    return std::nullopt;
+  }
+  ret.length = header_end + 3;
+
+  // Note: The category may contain ']', so the optional fields only start at
+  // the first "]["
+  auto cat_and_fields = line.substr(cat_begin, header_end - cat_begin);
+  auto cat_end = cat_and_fields.find("][");
+  ret.category = cat_and_fields.substr(0, cat_end);
+  if (cat_end != std::string_view::npos) {
+    ret.fields = line.substr(cat_begin + cat_end + 1,
+                             header_end + 1 - (cat_begin + cat_end + 1));
+  }
+  return ret;
+}
+} // namespace itst::tools
@@ -0,0 +1,169 @@
+#include "itst/FileLogger.h"
+#include "itst/SharedMemoryLogger.h"
+
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Drains the shared-memory rings that SharedMemoryLoggers write into and
+// appends their records to files. As the rings live in shared memory, the
+// collector can be restarted at any time and also collects the records of
+// processes that have crashed in the meantime.
+
+using namespace itst;
+
+namespace {
+volatile std::sig_atomic_t stop_requested = 0;
+
+void requestStop(int /*signal*/) { stop_requested = 1; }
+
+struct Options {
+  std::vector<std::pair<std::string, std::string>> rings;
+  size_t capacity = SharedMemoryRing::DefaultCapacity;
+  unsigned poll_ms = 10;
+  bool once = false;
+  bool unlink = false;
+};
+
+struct Target {
+  std::string ring_name;
+  std::unique_ptr<SharedMemoryRing> ring;
+  std::unique_ptr<FileLogger> logger;
+  uint64_t num_dropped = 0;
+};
+
+void printUsage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [options] <ring>=<log-file>...\n"
+          "Appends the records of the shared-memory rings to the log files.\n\n"
+          "Options:\n"
+          "  --capacity <bytes>   Capacity of the rings that do not exist yet\n"
+          "                       (default: 4MiB)\n"
+          "  --poll-ms <ms>       Polling interval when idle (default: 10)\n"
+          "  --once               Drain the rings once and exit\n"
+          "  --unlink             Remove the rings on exit\n",
+          prog);
+}
+
+template <typename T> bool parseNumber(std::string_view str, T &value) {
+  auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+  return ec == std::errc() && ptr == str.data() + str.size();
+}
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    auto next = [&]() -> std::string_view {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "Missing value for %s\n", argv[i]);
+        return {};
+      }
+      return argv[++i];
+    };
+
+    if (arg == "--capacity") {
+      if (!parseNumber(next(), opts.capacity) || !opts.capacity) {
+        fputs("Invalid capacity\n", stderr);
+        return false;
+      }
+    } else if (arg == "--poll-ms") {
+      if (!parseNumber(next(), opts.poll_ms)) {
+        fputs("Invalid polling interval\n", stderr);
+        return false;
+      }
+    } else if (arg == "--once") {
+      opts.once = true;
+    } else if (arg == "--unlink") {
+      opts.unlink = true;
+    } else if (arg == "--help" || arg == "-h") {
+      return false;
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return false;
+    } else {
+      auto eq = arg.find('=');
+      if (eq == std::string_view::npos || eq == 0 || eq + 1 == arg.size()) {
+        fprintf(stderr, "Expected <ring>=<log-file>, got %s\n", argv[i]);
+        return false;
+      }
+      opts.rings.emplace_back(arg.substr(0, eq), arg.substr(eq + 1));
+    }
+  }
+
+  return !opts.rings.empty();
+}
+
+void writeRecord(void *context, uint64_t /*seq*/,
+                 std::string_view record) noexcept {
+  static_cast<StdioSink *>(context)->write(record);
+}
+
+/// Returns the number of records written
+size_t drain(Target &target) {
+  auto num_records = target.ring->read(&writeRecord, target.logger->getSink());
+
+  if (auto num_dropped = target.ring->getNumDropped();
+      num_dropped != target.num_dropped) {
+    target.logger->logWarning("Dropped ", num_dropped - target.num_dropped,
+                              " records of ring ", target.ring_name);
+    target.num_dropped = num_dropped;
+  }
+
+  if (num_records) {
+    target.logger->flush();
+  }
+  return num_records;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opts;
+  if (!parseArgs(argc, argv, opts)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  std::vector<Target> targets;
+  for (const auto &[ring_name, file_name] : opts.rings) {
+    auto &target = targets.emplace_back();
+    target.ring_name = ring_name;
+    target.ring =
+        std::make_unique<SharedMemoryRing>(ring_name.c_str(), opts.capacity);
+    target.logger = std::make_unique<FileLogger>(file_name, "itst-collector");
+    if (!target.logger->getSink()) {
+      return 1;
+    }
+    // Only report the drops that happen while we are collecting
+    target.num_dropped = target.ring->getNumDropped();
+  }
+
+  std::signal(SIGINT, requestStop);
+  std::signal(SIGTERM, requestStop);
+
+  while (true) {
+    size_t num_records = 0;
+    for (auto &target : targets) {
+      num_records += drain(target);
+    }
+
+    if (opts.once || stop_requested) {
+      break;
+    }
+    if (!num_records) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(opts.poll_ms));
+    }
+  }
+
+  if (opts.unlink) {
+    for (const auto &target : targets) {
+      SharedMemoryRing::remove(target.ring_name.c_str());
+    }
+  }
+  return 0;
+}
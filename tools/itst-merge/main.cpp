@@ -0,0 +1,172 @@
+#include "LogFormat.h"
+
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Merges log files in the InsectLogger's text format into one file that is
+// ordered by the timestamps of the records, e.g., the per-thread shards of a
+// ShardedFileLogger. The inputs are read as streams and each of them must
+// already be ordered, so the merge only holds one record per input in memory.
+
+using namespace itst;
+using namespace itst::tools;
+
+namespace {
+struct Options {
+  std::vector<const char *> files;
+  const char *output = nullptr;
+};
+
+/// One input file, positioned at the record that is merged next
+struct Input {
+  FILE *file{};
+  /// The record including its continuation lines
+  std::string record;
+  TimeKey time = std::numeric_limits<TimeKey>::min();
+  /// The first line of the following record, if it has been read already
+  std::string next_line;
+  bool has_next_line = false;
+};
+
+void printUsage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [options] <log-file>...\n"
+          "Merges the records of the log files (e.g., the shards of a\n"
+          "ShardedFileLogger: <base>.*.log) ordered by their timestamps.\n"
+          "Records with equal timestamps keep the order of the files.\n\n"
+          "Options:\n"
+          "  -o, --output <file>  Write to <file> instead of stdout\n",
+          prog);
+}
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--output" || arg == "-o") {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "Missing value for %s\n", argv[i]);
+        return false;
+      }
+      opts.output = argv[++i];
+    } else if (arg == "--help" || arg == "-h") {
+      return false;
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return false;
+    } else {
+      opts.files.push_back(argv[i]);
+    }
+  }
+
+  return !opts.files.empty();
+}
+
+/// Reads one line including its '\n', which is added if it is missing at
+/// the end of the file
+bool readLine(FILE *file, std::string &line) {
+  line.clear();
+  char buf[4096];
+  while (fgets(buf, sizeof(buf), file)) {
+    line += buf;
+    if (line.back() == '\n') {
+      return true;
+    }
+  }
+  if (line.empty()) {
+    return false;
+  }
+  line += '\n';
+  return true;
+}
+
+/// Advances to the next record. Lines that do not start a record belong to the
+/// record before; lines before the first record keep the time of the record
+/// before, i.e., they are merged first.
+bool readRecord(Input &input) {
+  if (!input.has_next_line && !readLine(input.file, input.next_line)) {
+    return false;
+  }
+  input.record.swap(input.next_line);
+  input.has_next_line = false;
+  if (auto header = parseHeader(input.record)) {
+    input.time = header->time;
+  }
+
+  while (readLine(input.file, input.next_line)) {
+    if (parseHeader(input.next_line)) {
+      input.has_next_line = true;
+      break;
+    }
+    input.record += input.next_line;
+  }
+  return true;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opts;
+  if (!parseArgs(argc, argv, opts)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  FILE *out = stdout;
+  if (opts.output && !(out = fopen(opts.output, "w"))) {
+    perror(opts.output);
+    return 1;
+  }
+
+  int ret = 0;
+  std::vector<Input> inputs(opts.files.size());
+  // Min-heap of (time, input), such that ties keep the order of the inputs
+  std::priority_queue<std::pair<TimeKey, size_t>,
+                      std::vector<std::pair<TimeKey, size_t>>, std::greater<>>
+      heads;
+  for (size_t i = 0; i != inputs.size(); ++i) {
+    auto &input = inputs[i];
+    input.file = fopen(opts.files[i], "r");
+    if (!input.file) {
+      perror(opts.files[i]);
+      ret = 1;
+      continue;
+    }
+    if (readRecord(input)) {
+      heads.emplace(input.time, i);
+    }
+  }
+
+  while (!heads.empty()) {
+    auto idx = heads.top().second;
+    heads.pop();
+
+    auto &input = inputs[idx];
+    fwrite(input.record.data(), 1, input.record.size(), out);
+    if (readRecord(input)) {
+      heads.emplace(input.time, idx);
+    }
+  }
+
+  for (size_t i = 0; i != inputs.size(); ++i) {
+    if (inputs[i].file) {
+      if (ferror(inputs[i].file)) {
+        perror(opts.files[i]);
+        ret = 1;
+      }
+      fclose(inputs[i].file);
+    }
+  }
+  if (fflush(out) != 0 || ferror(out)) {
+    perror(opts.output ? opts.output : "stdout");
+    ret = 1;
+  }
+  if (out != stdout) {
+    fclose(out);
+  }
+  return ret;
+}
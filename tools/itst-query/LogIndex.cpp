@@ -0,0 +1,330 @@
+#include "LogIndex.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <unordered_map>
+
+namespace itst::tools {
+MappedFile::MappedFile(const char *file_name) noexcept
+    : fd(open(file_name, O_RDONLY | O_CLOEXEC)) {
+  if (fd < 0) {
+    return;
+  }
+
+  struct stat st {};
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    fd = -1;
+    return;
+  }
+
+  size = size_t(st.st_size);
+  mtime = int64_t(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec;
+  if (!size) {
+    return;
+  }
+
+  auto *ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (ptr == MAP_FAILED) {
+    close(fd);
+    fd = -1;
+    size = 0;
+    return;
+  }
+  data = static_cast<const char *>(ptr);
+}
+
+MappedFile::~MappedFile() {
+  if (data) {
+    munmap(const_cast<char *>(data), size);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+namespace {
+constexpr char IndexMagic[8] = {'I', 'T', 'S', 'T', 'I', 'D', 'X', '1'};
+constexpr size_t PrefixHashLength = 4096;
+
+/// Detects, whether the log file has been replaced instead of appended to
+uint64_t hashPrefix(std::string_view content) noexcept {
+  uint64_t hash = 14695981039346656037ULL;
+  for (char chr : content.substr(0, PrefixHashLength)) {
+    hash = (hash ^ uint8_t(chr)) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+/// Returns the offset of the first record that starts at or after pos
+size_t findRecordStart(std::string_view content, size_t pos) noexcept {
+  if (pos && content[pos - 1] != '\n') {
+    // Skip the rest of the current line
+    (void)nextLine(content, pos);
+  }
+
+  while (pos < content.size()) {
+    auto line_start = pos;
+    if (parseHeader(nextLine(content, pos))) {
+      return line_start;
+    }
+  }
+  return content.size();
+}
+
+struct PartialIndex {
+  std::vector<IndexBlock> blocks;
+  std::vector<std::string_view> categories;
+  std::unordered_map<std::string_view, size_t> category_ids;
+
+  void scan(std::string_view content, size_t begin, size_t end,
+            uint64_t block_size) {
+    IndexBlock *curr = nullptr;
+    size_t pos = begin;
+    while (pos < end) {
+      auto line_start = pos;
+      auto header = parseHeader(nextLine(content, pos));
+      if (!header) {
+        // Continuation of a multi-line record
+        continue;
+      }
+
+      if (!curr || line_start - curr->begin >= block_size) {
+        if (curr) {
+          curr->end = line_start;
+        }
+        curr = &blocks.emplace_back();
+        curr->begin = line_start;
+        curr->min_time = curr->max_time = header->time;
+      }
+
+      curr->min_time = std::min(curr->min_time, header->time);
+      curr->max_time = std::max(curr->max_time, header->time);
+      curr->severities |= uint32_t(1) << unsigned(header->severity);
+
+      auto [it, inserted] =
+          category_ids.try_emplace(header->category, categories.size());
+      if (inserted) {
+        categories.push_back(header->category);
+      }
+      curr->addCategory(it->second);
+    }
+
+    if (curr) {
+      curr->end = end;
+    }
+  }
+};
+
+template <typename T> void writeValue(FILE *file, const T &value) {
+  fwrite(&value, sizeof(T), 1, file);
+}
+template <typename T> bool readValue(FILE *file, T &value) {
+  return fread(&value, sizeof(T), 1, file) == 1;
+}
+} // namespace
+
+ptrdiff_t LogIndex::getCategoryId(std::string_view cat) const noexcept {
+  auto it = std::find(categories.begin(), categories.end(), cat);
+  return it == categories.end() ? -1 : it - categories.begin();
+}
+
+bool LogIndex::load(const std::string &index_name, const MappedFile &file) {
+  auto *idx = fopen(index_name.c_str(), "rb");
+  if (!idx) {
+    return false;
+  }
+
+  bool success = [&] {
+    char magic[sizeof(IndexMagic)]{};
+    uint64_t num_categories{};
+    uint64_t num_blocks{};
+    if (fread(magic, 1, sizeof(magic), idx) != sizeof(magic) ||
+        memcmp(magic, IndexMagic, sizeof(magic)) != 0 ||
+        !readValue(idx, file_size) || !readValue(idx, mtime) ||
+        !readValue(idx, block_size) || !readValue(idx, prefix_hash) ||
+        !readValue(idx, num_categories) || !readValue(idx, num_blocks)) {
+      return false;
+    }
+
+    categories.resize(num_categories);
+    for (auto &cat : categories) {
+      uint32_t len{};
+      if (!readValue(idx, len)) {
+        return false;
+      }
+      cat.resize(len);
+      if (fread(cat.data(), 1, len, idx) != len) {
+        return false;
+      }
+    }
+
+    auto num_words = (num_categories + 63) / 64;
+    blocks.resize(num_blocks);
+    for (auto &blk : blocks) {
+      blk.categories.resize(num_words);
+      if (!readValue(idx, blk.begin) || !readValue(idx, blk.end) ||
+          !readValue(idx, blk.min_time) || !readValue(idx, blk.max_time) ||
+          !readValue(idx, blk.severities) ||
+          fread(blk.categories.data(), sizeof(uint64_t), num_words, idx) !=
+              num_words) {
+        return false;
+      }
+    }
+    return true;
+  }();
+  fclose(idx);
+
+  auto content = file.content();
+  if (!success || file_size > content.size() ||
+      prefix_hash != hashPrefix(content.substr(0, file_size))) {
+    *this = LogIndex();
+    return false;
+  }
+  return true;
+}
+
+void LogIndex::store(const std::string &index_name,
+                     const MappedFile &file) const {
+  // Write to a temporary file first, such that concurrent queries never see a
+  // partially written index
+  auto tmp_name = index_name + ".tmp";
+  auto *idx = fopen(tmp_name.c_str(), "wb");
+  if (!idx) {
+    perror("Failed to write the index");
+    return;
+  }
+
+  fwrite(IndexMagic, 1, sizeof(IndexMagic), idx);
+  writeValue(idx, file_size);
+  writeValue(idx, file.getModificationTime());
+  writeValue(idx, block_size);
+  writeValue(idx, prefix_hash);
+  writeValue(idx, uint64_t(categories.size()));
+  writeValue(idx, uint64_t(blocks.size()));
+  for (const auto &cat : categories) {
+    writeValue(idx, uint32_t(cat.size()));
+    fwrite(cat.data(), 1, cat.size(), idx);
+  }
+
+  auto num_words = (categories.size() + 63) / 64;
+  std::vector<uint64_t> words;
+  for (const auto &blk : blocks) {
+    writeValue(idx, blk.begin);
+    writeValue(idx, blk.end);
+    writeValue(idx, blk.min_time);
+    writeValue(idx, blk.max_time);
+    writeValue(idx, blk.severities);
+    words.assign(num_words, 0);
+    std::copy(blk.categories.begin(), blk.categories.end(), words.begin());
+    fwrite(words.data(), sizeof(uint64_t), num_words, idx);
+  }
+
+  if (fclose(idx) != 0 || rename(tmp_name.c_str(), index_name.c_str()) != 0) {
+    perror("Failed to write the index");
+    unlink(tmp_name.c_str());
+  }
+}
+
+void LogIndex::build(std::string_view content, uint64_t from,
+                     unsigned num_threads) {
+  auto size = content.size();
+  num_threads = std::max(1U, num_threads);
+
+  // Split the rest of the file into one range per thread. Each range starts at
+  // a record, such that no record is split between two threads
+  std::vector<size_t> bounds{from};
+  for (unsigned i = 1; i < num_threads; ++i) {
+    auto pos = from + (size - from) * i / num_threads;
+    bounds.push_back(std::max(bounds.back(), findRecordStart(content, pos)));
+  }
+  bounds.push_back(size);
+
+  std::vector<PartialIndex> partials(num_threads);
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i != num_threads; ++i) {
+    threads.emplace_back([&, i] {
+      partials[i].scan(content, bounds[i], bounds[i + 1], block_size);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Merge the thread-local category ids
+  std::unordered_map<std::string_view, size_t> global_ids;
+  for (size_t i = 0; i != categories.size(); ++i) {
+    global_ids.emplace(categories[i], i);
+  }
+
+  std::vector<std::string_view> new_categories;
+  for (auto &partial : partials) {
+    std::vector<size_t> id_map;
+    for (auto cat : partial.categories) {
+      auto [it, inserted] = global_ids.try_emplace(
+          cat, categories.size() + new_categories.size());
+      if (inserted) {
+        new_categories.push_back(cat);
+      }
+      id_map.push_back(it->second);
+    }
+
+    for (auto &blk : partial.blocks) {
+      IndexBlock merged = blk;
+      merged.categories.clear();
+      for (size_t id = 0; id != id_map.size(); ++id) {
+        if (blk.hasCategory(id)) {
+          merged.addCategory(id_map[id]);
+        }
+      }
+      blocks.push_back(std::move(merged));
+    }
+  }
+
+  categories.insert(categories.end(), new_categories.begin(),
+                    new_categories.end());
+}
+
+LogIndex LogIndex::get(const char *file_name, const MappedFile &file,
+                       uint64_t block_size, unsigned num_threads,
+                       bool use_cache, bool write_cache) {
+  auto index_name = std::string(file_name) + ".itstidx";
+  auto content = file.content();
+
+  LogIndex ret;
+  if (use_cache && ret.load(index_name, file) &&
+      ret.block_size == block_size) {
+    if (ret.file_size == content.size() &&
+        ret.mtime == file.getModificationTime()) {
+      return ret;
+    }
+  } else {
+    ret = LogIndex();
+    ret.block_size = block_size;
+  }
+
+  // The log has been appended to. The last block may have been incomplete, so
+  // index it again together with the new part
+  uint64_t from = 0;
+  if (!ret.blocks.empty()) {
+    from = ret.blocks.back().begin;
+    ret.blocks.pop_back();
+  }
+
+  ret.build(content, from, num_threads);
+  ret.file_size = content.size();
+  ret.mtime = file.getModificationTime();
+  ret.prefix_hash = hashPrefix(content);
+
+  if (write_cache) {
+    ret.store(index_name, file);
+  }
+  return ret;
+}
+} // namespace itst::tools
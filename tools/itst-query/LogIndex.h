@@ -0,0 +1,103 @@
+#pragma once
+
+#include "LogFormat.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace itst::tools {
+
+/// A memory-mapped, read-only log file.
+class MappedFile {
+public:
+  explicit MappedFile(const char *file_name) noexcept;
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  [[nodiscard]] bool valid() const noexcept { return fd >= 0; }
+  [[nodiscard]] std::string_view content() const noexcept {
+    return {data, size};
+  }
+  [[nodiscard]] int64_t getModificationTime() const noexcept { return mtime; }
+
+private:
+  int fd = -1;
+  const char *data{};
+  size_t size{};
+  int64_t mtime{};
+};
+
+/// Summary of a consecutive range of records.
+struct IndexBlock {
+  uint64_t begin{};
+  uint64_t end{};
+  TimeKey min_time{};
+  TimeKey max_time{};
+  /// Bit i is set, iff the block contains a record with LogSeverity(i)
+  uint32_t severities{};
+  /// Bit i is set, iff the block contains a record of category i
+  std::vector<uint64_t> categories;
+
+  [[nodiscard]] bool hasCategory(size_t id) const noexcept {
+    return id / 64 < categories.size() &&
+           (categories[id / 64] >> (id % 64)) & 1;
+  }
+  void addCategory(size_t id) {
+    if (id / 64 >= categories.size()) {
+      categories.resize(id / 64 + 1);
+    }
+    categories[id / 64] |= uint64_t(1) << (id % 64);
+  }
+};
+
+/// A sparse index over a log file: Each block covers roughly block_size bytes
+/// of whole records and stores their time range, severities and categories.
+///
+/// The index is cached in a sidecar file "<log>.itstidx". When the log has
+/// grown since, only the new part is indexed.
+class LogIndex {
+public:
+  static constexpr uint64_t DefaultBlockSize = uint64_t(1) << 20;
+
+  /// Loads the index from the sidecar file, or (re)builds it, using the given
+  /// number of threads. Writes the sidecar file, if write_cache is true.
+  static LogIndex get(const char *file_name, const MappedFile &file,
+                      uint64_t block_size, unsigned num_threads,
+                      bool use_cache, bool write_cache);
+
+  [[nodiscard]] const std::vector<IndexBlock> &getBlocks() const noexcept {
+    return blocks;
+  }
+
+  /// Returns the id of the category, or -1 if no record has this category.
+  [[nodiscard]] ptrdiff_t getCategoryId(std::string_view cat) const noexcept;
+
+private:
+  bool load(const std::string &index_name, const MappedFile &file);
+  void store(const std::string &index_name, const MappedFile &file) const;
+  void build(std::string_view content, uint64_t from, unsigned num_threads);
+
+  uint64_t file_size{};
+  int64_t mtime{};
+  uint64_t block_size = DefaultBlockSize;
+  uint64_t prefix_hash{};
+  std::vector<std::string> categories;
+  std::vector<IndexBlock> blocks;
+};
+
+/// Iterates over the lines in content, starting at pos. Returns the line
+/// without its line-feed and advances pos behind it.
+[[nodiscard]] inline std::string_view nextLine(std::string_view content,
+                                               size_t &pos) noexcept {
+  const auto *begin = content.data() + pos;
+  const auto *nl = static_cast<const char *>(
+      memchr(begin, '\n', content.size() - pos));
+  size_t len = nl ? size_t(nl - begin) : content.size() - pos;
+  pos += nl ? len + 1 : len;
+  return {begin, len};
+}
+} // namespace itst::tools
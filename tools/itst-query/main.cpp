@@ -0,0 +1,255 @@
+#include "LogFormat.h"
+#include "LogIndex.h"
+
+#include "itst/LogSeverity.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Answers time-range, severity and category queries on log files written in
+// the InsectLogger's text format. The files are memory-mapped and only the
+// blocks that the sparse index (see LogIndex) reports as candidates are
+// scanned, in parallel.
+
+using namespace itst;
+using namespace itst::tools;
+
+namespace {
+struct Query {
+  TimeKey from = std::numeric_limits<TimeKey>::min();
+  TimeKey to = std::numeric_limits<TimeKey>::max();
+  LogSeverity min_severity = LogSeverity::Trace;
+  std::vector<std::string_view> categories;
+
+  [[nodiscard]] bool matches(const RecordHeader &header) const noexcept {
+    return header.time >= from && header.time < to &&
+           header.severity >= min_severity &&
+           (categories.empty() ||
+            std::find(categories.begin(), categories.end(),
+                      header.category) != categories.end());
+  }
+};
+
+struct Options {
+  Query query;
+  std::vector<const char *> files;
+  unsigned num_threads = std::max(1U, std::thread::hardware_concurrency());
+  uint64_t block_size = LogIndex::DefaultBlockSize;
+  bool use_cache = true;
+  bool write_cache = true;
+  bool count_only = false;
+};
+
+void printUsage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [options] <log-file>...\n"
+          "Prints the records that match all given filters.\n\n"
+          "Options:\n"
+          "  --from <time>        Only records at or after <time>\n"
+          "  --to <time>          Only records before <time>\n"
+          "                       <time>: 'YYYY-MM-DD[ hh:mm[:ss[.ffffff]]]'\n"
+          "  --severity <sev>     Only records with at least severity <sev>\n"
+          "  --category <cat>     Only records of category <cat> (repeatable)\n"
+          "  --count              Only print the number of matching records\n"
+          "  --threads <n>        Number of threads (default: all cores)\n"
+          "  --block-size <bytes> Granularity of the index (default: 1MiB)\n"
+          "  --rebuild-index      Ignore the cached index\n"
+          "  --no-index-file      Don't write the index <log-file>.itstidx\n",
+          prog);
+}
+
+template <typename T> bool parseNumber(std::string_view str, T &value) {
+  auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+  return ec == std::errc() && ptr == str.data() + str.size();
+}
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    auto next = [&]() -> std::optional<std::string_view> {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "Missing value for %s\n", argv[i]);
+        return std::nullopt;
+      }
+      return argv[++i];
+    };
+
+    if (arg == "--from" || arg == "--to") {
+      auto val = next();
+      auto time = val ? parseTimestampPrefix(*val) : std::nullopt;
+      if (!time) {
+        fprintf(stderr, "Invalid time for %s\n", arg.data());
+        return false;
+      }
+      (arg == "--from" ? opts.query.from : opts.query.to) = *time;
+    } else if (arg == "--severity") {
+      auto val = next();
+      std::string upper(val.value_or(""));
+      std::transform(upper.begin(), upper.end(), upper.begin(),
+                     [](unsigned char chr) { return char(toupper(chr)); });
+      auto sev = from_string(upper);
+      if (!sev) {
+        fprintf(stderr, "Invalid severity '%s'\n", upper.c_str());
+        return false;
+      }
+      opts.query.min_severity = *sev;
+    } else if (arg == "--category") {
+      auto val = next();
+      if (!val) {
+        return false;
+      }
+      opts.query.categories.push_back(*val);
+    } else if (arg == "--threads") {
+      auto val = next();
+      if (!val || !parseNumber(*val, opts.num_threads) || !opts.num_threads) {
+        fputs("Invalid number of threads\n", stderr);
+        return false;
+      }
+    } else if (arg == "--block-size") {
+      auto val = next();
+      if (!val || !parseNumber(*val, opts.block_size) || !opts.block_size) {
+        fputs("Invalid block size\n", stderr);
+        return false;
+      }
+    } else if (arg == "--count") {
+      opts.count_only = true;
+    } else if (arg == "--rebuild-index") {
+      opts.use_cache = false;
+    } else if (arg == "--no-index-file") {
+      opts.write_cache = false;
+    } else if (arg == "--help" || arg == "-h") {
+      return false;
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return false;
+    } else {
+      opts.files.push_back(argv[i]);
+    }
+  }
+
+  return !opts.files.empty();
+}
+
+/// Whether the block may contain matching records according to the index
+bool isCandidate(const IndexBlock &blk, const Query &query,
+                 const std::vector<ptrdiff_t> &category_ids) noexcept {
+  if (blk.max_time < query.from || blk.min_time >= query.to) {
+    return false;
+  }
+  if (!(blk.severities >> unsigned(query.min_severity))) {
+    return false;
+  }
+  if (query.categories.empty()) {
+    return true;
+  }
+  return std::any_of(
+      category_ids.begin(), category_ids.end(),
+      [&blk](auto id) { return id >= 0 && blk.hasCategory(size_t(id)); });
+}
+
+/// Appends all matching records of the block to out. Returns the number of
+/// matching records
+size_t scanBlock(std::string_view content, const IndexBlock &blk,
+                 const Query &query, std::string *out) {
+  size_t num_matches = 0;
+  bool in_match = false;
+  size_t pos = blk.begin;
+  while (pos < blk.end) {
+    auto line_start = pos;
+    auto line = nextLine(content, pos);
+    if (auto header = parseHeader(line)) {
+      in_match = query.matches(*header);
+      num_matches += in_match;
+    }
+    if (in_match && out) {
+      out->append(content.substr(line_start, pos - line_start));
+    }
+  }
+  return num_matches;
+}
+
+size_t queryFile(const char *file_name, const Options &opts) {
+  MappedFile file(file_name);
+  if (!file.valid()) {
+    perror(file_name);
+    return 0;
+  }
+
+  auto index = LogIndex::get(file_name, file, opts.block_size,
+                             opts.num_threads, opts.use_cache,
+                             opts.write_cache);
+
+  std::vector<ptrdiff_t> category_ids;
+  for (auto cat : opts.query.categories) {
+    category_ids.push_back(index.getCategoryId(cat));
+  }
+
+  std::vector<const IndexBlock *> candidates;
+  for (const auto &blk : index.getBlocks()) {
+    if (isCandidate(blk, opts.query, category_ids)) {
+      candidates.push_back(&blk);
+    }
+  }
+
+  // Scan the candidates in waves, such that the output is printed in order
+  // without keeping all matches in memory
+  auto content = file.content();
+  size_t wave_size = size_t(opts.num_threads) * 4;
+  std::vector<std::string> outputs(wave_size);
+  std::atomic<size_t> num_matches{};
+
+  for (size_t wave = 0; wave < candidates.size(); wave += wave_size) {
+    auto wave_end = std::min(candidates.size(), wave + wave_size);
+    std::atomic<size_t> next{wave};
+
+    auto worker = [&] {
+      for (size_t i; (i = next.fetch_add(1)) < wave_end;) {
+        auto *out = opts.count_only ? nullptr : &outputs[i - wave];
+        num_matches += scanBlock(content, *candidates[i], opts.query, out);
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < opts.num_threads; ++i) {
+      threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    for (size_t i = 0; i != wave_end - wave; ++i) {
+      fwrite(outputs[i].data(), 1, outputs[i].size(), stdout);
+      outputs[i].clear();
+    }
+  }
+
+  return num_matches;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opts;
+  if (!parseArgs(argc, argv, opts)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  size_t num_matches = 0;
+  for (const auto *file_name : opts.files) {
+    num_matches += queryFile(file_name, opts);
+  }
+
+  if (opts.count_only) {
+    printf("%zu\n", num_matches);
+  }
+  return 0;
+}
@@ -0,0 +1,52 @@
+#!/bin/sh
+# Measures what including the public headers costs a translation unit: the
+# size of the preprocessed source and the best of several compile times of a
+# file that includes the header and logs one message. Run it before and after
+# changing the headers to compare.
+#
+# Usage: tools/measure-header-cost.sh [runs] (compiler: $CXX, default c++)
+
+set -eu
+
+RUNS=${1:-5}
+CXX=${CXX:-c++}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+now_ms() {
+  date +%s%3N
+}
+
+measure() {
+  name=$1
+  src=$2
+  printf '%s\n' "$src" >"$TMP/tu.cpp"
+
+  bytes=$($CXX -std=c++17 -w -I"$ROOT/include" -E "$TMP/tu.cpp" | wc -c)
+
+  best=
+  i=0
+  while [ "$i" -lt "$RUNS" ]; do
+    begin=$(now_ms)
+    $CXX -std=c++17 -w -I"$ROOT/include" -c "$TMP/tu.cpp" -o "$TMP/tu.o"
+    end=$(now_ms)
+    time=$((end - begin))
+    if [ -z "$best" ] || [ "$time" -lt "$best" ]; then
+      best=$time
+    fi
+    i=$((i + 1))
+  done
+
+  printf '%-24s %12s %10s\n' "$name" "$bytes" "$best"
+}
+
+LOG='void f(int x) { ITST_LOGGER; ITST_LOG(Info, "x = ", x); }'
+
+printf '%-24s %12s %10s\n' "header" "preproc. B" "best ms"
+measure "(empty)" ""
+measure "itst/LoggerFwd.h" '#include "itst/LoggerFwd.h"'
+measure "itst/Log.h" "#include \"itst/Log.h\"
+$LOG"
+measure "itst/Logger.hpp" "#include \"itst/Logger.hpp\"
+$LOG"